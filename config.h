@@ -6,6 +6,11 @@ static const unsigned int gappx     = 5;        /* gaps between windows */
 static const unsigned int snap      = 0;       /* snap pixel */
 static const int showbar            = 1;        /* 0 means no bar */
 static const int topbar             = 1;        /* 0 means bottom bar */
+static const int animframes         = 12;       /* frames per tag slide, 0 disables */
+static const int animrefresh        = 60;       /* refresh rate (Hz) if RandR can't tell */
+static const int animlayout         = 1;        /* 1 means animate layout reflows */
+static const int titleinterval      = 100;      /* ms between refetches of a changing title */
+static const int swallowfloating    = 0;        /* 1 means swallow floating windows by default */
 
 static const int  usealtbar        = 1;        /* 1 means use non-dwm status bar */
 static const char *altbarclass     = "Polybar"; /* Alternate bar class name */
@@ -57,10 +62,16 @@ static const Rule rules[] = {
 	/* xprop(1):
 	 *	WM_CLASS(STRING) = instance, class
 	 *	WM_NAME(STRING) = title
+	 * strings match exactly, as globs if they contain any of *?[
+	 * and as extended regular expressions when written /like this/;
+	 * plain strings used to match as substrings, write *Firefox* for that
 	 */
-	/* class      instance    title       tags mask     isfloating   monitor */
-	{ "Gimp",     NULL,       NULL,       0,            1,           -1 },
-	{ "Firefox",  NULL,       NULL,       1 << 8,       0,           -1 },
+	/* class      instance    title       tags mask     isfloating   isterminal   noswallow   monitor */
+	{ "Gimp",     NULL,       NULL,       0,            1,           0,           0,          -1 },
+	{ "Firefox",  NULL,       NULL,       1 << 8,       0,           0,           0,          -1 },
+	{ "St",       NULL,       NULL,       0,            0,           1,           0,          -1 },
+	{ NULL,       "spterm",   NULL,       SPTAG(0),     1,           0,           0,          -1 },
+	{ NULL,       "spcalc",   NULL,       SPTAG(1),     1,           0,           1,          -1 },
 };
 
 /* layout(s) */
@@ -91,8 +102,24 @@ static const Layout layouts[] = {
 static char dmenumon[2] = "0"; /* component of dmenucmd, manipulated in spawn() */
 static const char *dmenucmd[] = { "dmenu_run", "-m", dmenumon, "-fn", dmenufont, "-nb", col_gray1, "-nf", col_gray3, "-sb", col_cyan, "-sf", col_gray4, NULL };
 static const char *termcmd[]  = { "st", NULL };
+static const char *emacscmd[] = { "emacs", NULL };
 static const char *boomercmd[]  = { "boomer", NULL };
 
+/* scratchpads, started hidden and matched by the rules above */
+static const char *spcmd1[] = { "st", "-n", "spterm", "-g", "120x34", NULL };
+static const char *spcmd2[] = { "st", "-n", "spcalc", "-g", "50x20", "-e", "bc", "-lq", NULL };
+static const Sp scratchpads[] = {
+	/* name          cmd  */
+	{ "spterm",      spcmd1 },
+	{ "spcalc",      spcmd2 },
+};
+
+/* commands kept started ahead on a hidden tag, handed out by spawnpool */
+static const Pool pools[] = {
+	/* cmd           instances */
+	{ termcmd,       2 },
+};
+
 
 #include "selfrestart.c"
 static const Key keys[] = {
@@ -105,10 +132,15 @@ static const Key keys[] = {
     { MODKEY,                       XK_b,      viewprev,       {0} },
     { MODKEY|ShiftMask,             XK_f,      tagtonext,      {0} },
     { MODKEY|ShiftMask,             XK_b,      tagtoprev,      {0} },
+    { MODKEY|ShiftMask,             XK_Up,     tagup,          {0} },
+    { MODKEY|ShiftMask,             XK_Down,   tagdown,        {0} },
+    { MODKEY|ShiftMask,             XK_p,      tagup,          {0} },
+    { MODKEY|ShiftMask,             XK_n,      tagdown,        {0} },
 	{ MODKEY,                       XK_z,      spawn,          {.v = boomercmd } },
 	{ MODKEY,                       XK_x,      spawn,          {.v = dmenucmd } },
-	{ MODKEY,                       XK_Return, spawn,          {.v = termcmd } },
-	{ MODKEY,                       XK_m,      spawn,          {.v = termcmd } },
+	{ MODKEY,                       XK_Return, spawnpool,      {.v = termcmd } },
+	{ MODKEY,                       XK_m,      togglescratch,  {.ui = 0 } },
+	{ MODKEY|ShiftMask,             XK_m,      togglescratch,  {.ui = 1 } },
 	{ MODKEY|ControlMask,           XK_b,      togglebar,      {0} },
 	{ MODKEY|ShiftMask,             XK_j,      rotatestack,    {.i = +1 } },
 	{ MODKEY|ShiftMask,             XK_k,      rotatestack,    {.i = -1 } },
@@ -127,12 +159,18 @@ static const Key keys[] = {
 	/* { MODKEY,                       XK_m,      setlayout,      {.v = &layouts[2]} }, */
 	{ MODKEY,                       XK_space,  setlayout,      {0} },
 	{ MODKEY|ShiftMask,             XK_space,  togglefloating, {0} },
+	{ MODKEY,                       XK_e,      dow_emacs,      {0} },
+	{ MODKEY|ControlMask,           XK_r,      reapplyrules,   {0} },
+	{ MODKEY|ControlMask,           XK_s,      sessionsave,    {0} },
+	{ MODKEY|ControlMask|ShiftMask, XK_s,      sessionload,    {0} },
 	{ MODKEY,                       XK_0,      view,           {.ui = ~0 } },
 	{ MODKEY|ShiftMask,             XK_0,      tag,            {.ui = ~0 } },
 	{ MODKEY,                       XK_comma,  focusmon,       {.i = -1 } },
 	{ MODKEY,                       XK_period, focusmon,       {.i = +1 } },
 	{ MODKEY|ShiftMask,             XK_comma,  tagmon,         {.i = -1 } },
 	{ MODKEY|ShiftMask,             XK_period, tagmon,         {.i = +1 } },
+	{ MODKEY|ControlMask,           XK_comma,  swapmon,        {.i = -1 } },
+	{ MODKEY|ControlMask,           XK_period, swapmon,        {.i = +1 } },
     { MODKEY,                       XK_Right,  viewnext,       {0} },
     { MODKEY,                       XK_Left,   viewprev,       {0} },
     { MODKEY|ShiftMask,             XK_Right,  tagtonext,      {0} },
@@ -172,12 +210,27 @@ static const Button buttons[] = {
 };
 
 static const char *ipcsockpath = "/tmp/dwm.sock";
+static const char *journalpath = "dwm.journal"; /* in $XDG_RUNTIME_DIR or ~/.cache, one per display; NULL for none */
+static const char *sessionpath = "~/.local/share/dwm/session";
+static const int loadsession = 0; /* 1 to relaunch the saved session at startup */
 static IPCCommand ipccommands[] = {
     IPCCOMMAND(  view,                1,      {ARG_TYPE_UINT}   ),
     IPCCOMMAND(  toggleview,          1,      {ARG_TYPE_UINT}   ),
     IPCCOMMAND(  tag,                 1,      {ARG_TYPE_UINT}   ),
     IPCCOMMAND(  toggletag,           1,      {ARG_TYPE_UINT}   ),
     IPCCOMMAND(  tagmon,              1,      {ARG_TYPE_UINT}   ),
+    IPCCOMMAND(  swapmon,             1,      {ARG_TYPE_SINT}   ),
+    IPCCOMMAND(  togglescratch,       1,      {ARG_TYPE_UINT}   ),
+    IPCCOMMAND(  reapplyrules,        1,      {ARG_TYPE_NONE}   ),
+    IPCCOMMAND(  killtag,             1,      {ARG_TYPE_UINT}   ),
+    IPCCOMMAND(  sessionsave,         1,      {ARG_TYPE_NONE}   ),
+    IPCCOMMAND(  sessionload,         1,      {ARG_TYPE_NONE}   ),
+    IPCCOMMAND(  dow_emacs,           1,      {ARG_TYPE_NONE}   ),
+    IPCCOMMANDARGS( tagclass,         2,      {ARG_TYPE_STR, ARG_TYPE_UINT} ),
+    IPCCOMMAND(  viewup,              1,      {ARG_TYPE_NONE}   ),
+    IPCCOMMAND(  viewdown,            1,      {ARG_TYPE_NONE}   ),
+    IPCCOMMAND(  tagup,               1,      {ARG_TYPE_NONE}   ),
+    IPCCOMMAND(  tagdown,             1,      {ARG_TYPE_NONE}   ),
     IPCCOMMAND(  focusmon,            1,      {ARG_TYPE_SINT}   ),
     IPCCOMMAND(  focusstack,          1,      {ARG_TYPE_SINT}   ),
     IPCCOMMAND(  zoom,                1,      {ARG_TYPE_NONE}   ),
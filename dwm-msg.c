@@ -23,6 +23,7 @@
 #define IPC_EVENT_MONITOR_FOCUS_CHANGE "monitor_focus_change_event"
 #define IPC_EVENT_FOCUSED_TITLE_CHANGE "focused_title_change_event"
 #define IPC_EVENT_FOCUSED_STATE_CHANGE "focused_state_change_event"
+#define IPC_EVENT_RESTART "restart_event"
 
 #define YSTR(str) yajl_gen_string(gen, (unsigned char *)str, strlen(str))
 #define YINT(num) yajl_gen_integer(gen, num)
@@ -55,7 +56,9 @@ typedef enum IPCMessageType {
   IPC_TYPE_GET_LAYOUTS = 3,
   IPC_TYPE_GET_DWM_CLIENT = 4,
   IPC_TYPE_SUBSCRIBE = 5,
-  IPC_TYPE_EVENT = 6
+  IPC_TYPE_EVENT = 6,
+  IPC_TYPE_GET_LAUNCHES = 7,
+  IPC_TYPE_GET_SUPERVISED = 8
 } IPCMessageType;
 
 // Every IPC message must begin with this
@@ -377,6 +380,24 @@ get_layouts()
   return 0;
 }
 
+static int
+get_launches()
+{
+  send_message(IPC_TYPE_GET_LAUNCHES, 1, (uint8_t *)"");
+  print_socket_reply();
+
+  return 0;
+}
+
+static int
+get_supervised()
+{
+  send_message(IPC_TYPE_GET_SUPERVISED, 1, (uint8_t *)"");
+  print_socket_reply();
+
+  return 0;
+}
+
 static int
 get_dwm_client(Window win)
 {
@@ -469,6 +490,10 @@ print_usage(const char *name)
   puts("");
   puts("  get_layouts                     Get list of layouts");
   puts("");
+  puts("  get_launches                    Get spawn to map latency per command");
+  puts("");
+  puts("  get_supervised                  Get autostart and bar processes");
+  puts("");
   puts("  get_dwm_client <window_id>      Get dwm client proprties");
   puts("");
   puts("  subscribe [events...]           Subscribe to specified events");
@@ -477,7 +502,8 @@ print_usage(const char *name)
   puts("                                  " IPC_EVENT_CLIENT_FOCUS_CHANGE ",");
   puts("                                  " IPC_EVENT_MONITOR_FOCUS_CHANGE ",");
   puts("                                  " IPC_EVENT_FOCUSED_TITLE_CHANGE ",");
-  puts("                                  " IPC_EVENT_FOCUSED_STATE_CHANGE);
+  puts("                                  " IPC_EVENT_FOCUSED_STATE_CHANGE ",");
+  puts("                                  " IPC_EVENT_RESTART);
   puts("");
   puts("  help                            Display this message");
   puts("");
@@ -523,6 +549,10 @@ main(int argc, char *argv[])
     get_tags();
   } else if (strcmp(argv[i], "get_layouts") == 0) {
     get_layouts();
+  } else if (strcmp(argv[i], "get_launches") == 0) {
+    get_launches();
+  } else if (strcmp(argv[i], "get_supervised") == 0) {
+    get_supervised();
   } else if (strcmp(argv[i], "get_dwm_client") == 0) {
     if (++i < argc) {
       if (is_unsigned_int(argv[i])) {
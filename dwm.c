@@ -21,26 +21,40 @@
  * To understand everything else, start reading main().
  */
 #include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
 #include <locale.h>
+#include <regex.h>
 #include <signal.h>
+#include <spawn.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
 #include <X11/cursorfont.h>
 #include <X11/keysym.h>
 #include <X11/Xatom.h>
 #include <X11/Xlib.h>
+#include <X11/Xlib-xcb.h>
 #include <X11/Xproto.h>
 #include <X11/Xutil.h>
 #ifdef XINERAMA
 #include <X11/extensions/Xinerama.h>
 #endif /* XINERAMA */
+#ifdef XRANDR
+#include <X11/extensions/Xrandr.h>
+#endif /* XRANDR */
 #include <X11/Xft/Xft.h>
+#include <xcb/xcb.h>
 
 #include "drw.h"
 #include "util.h"
@@ -50,22 +64,50 @@
 #define CLEANMASK(mask)         (mask & ~(numlockmask|LockMask) & (ShiftMask|ControlMask|Mod1Mask|Mod2Mask|Mod3Mask|Mod4Mask|Mod5Mask))
 #define INTERSECT(x,y,w,h,m)    (MAX(0, MIN((x)+(w),(m)->mx+(m)->mw) - MAX((x),(m)->mx)) \
                                * MAX(0, MIN((y)+(h),(m)->my+(m)->mh) - MAX((y),(m)->my)))
-#define ISVISIBLE(C)            ((C->tags & C->mon->tagset[C->mon->seltags]))
+#define INMON(X,Y,M)            ((X) >= (M)->mx && (X) < (M)->mx + (M)->mw \
+                               && (Y) >= (M)->my && (Y) < (M)->my + (M)->mh)
+#define INVIEW(C,S)             ((C->tags & C->mon->tagset[S]) && C->row == C->mon->row[S])
+#define ISVISIBLE(C)            INVIEW(C, C->mon->seltags)
 #define MOUSEMASK               (BUTTONMASK|PointerMotionMask)
 #define WIDTH(X)                ((X)->w + 2 * (X)->bw)
 #define HEIGHT(X)               ((X)->h + 2 * (X)->bw)
 #define TAGMASK                 ((1 << LENGTH(tags)) - 1)
 #define TAGSLENGTH              (LENGTH(tags))
 #define TEXTW(X)                (drw_fontset_getwidth(drw, (X)) + lrpad)
+#define SLABSIZE                64 /* clients allocated at a time */
+#define SPTAG(i)                ((1 << LENGTH(tags)) << (i)) /* hidden scratchpad tags */
+#define SPTAGMASK               (((1 << LENGTH(scratchpads)) - 1) << LENGTH(tags))
+#define POOLTAG(i)              (SPTAG(LENGTH(scratchpads)) << (i)) /* hidden warm pool tags */
+#define POOLTAGMASK             (((1 << LENGTH(pools)) - 1) << (LENGTH(tags) + LENGTH(scratchpads)))
+#define POOLTIMEOUT             10000 /* ms a pool instance may take to map */
+#define SESSIONTIMEOUT          60000 /* ms a loaded session waits for its windows */
+#define SESSIONARGS             64    /* longest command line a session keeps */
+#define PIDCACHETTL             5000 /* ms a cached parent pid is trusted */
+#define LAUNCHSAMPLES           64 /* launches kept per command for percentiles */
+#define SUPBACKOFF              500 /* ms before the first restart of a crashed child */
+#define SUPBACKOFFMAX           60000 /* ms the restart delay doubles up to */
+#define SUPSTABLE               60000 /* ms of running that forgive earlier crashes */
+#define SUPQUITWAIT             500 /* ms quit() waits for them to exit */
+#define GRIDROWS                64    /* inner tags a column may grow to */
+#define SNAPMAGIC               "dwmsnap2"
+#define JOURNALMONS             8
+#define JOURNALCLIENTS          256
+#define JOURNALSUP              32
+#define SWAP(T,A,B)             do { T t_ = (A); (A) = (B); (B) = t_; } while (0)
 
 enum { CurNormal, CurResize, CurMove, CurLast }; /* cursor */
 enum { SchemeNorm, SchemeSel }; /* color schemes */
+enum { SupRunning, SupBackoff, SupDone, SupStopped }; /* supervised states */
 enum { NetSupported, NetWMName, NetWMState, NetWMCheck,
     NetWMFullscreen, NetActiveWindow, NetWMWindowType,
-    NetWMWindowTypeDialog, NetClientList, NetDesktopNames, 
+    NetWMWindowTypeDialog, NetClientList, NetClientListStacking, NetDesktopNames, 
     NetDesktopViewport, NetNumberOfDesktops, NetCurrentDesktop, 
-    NetClientInfo, NetLast }; /* EWMH atoms */
+    NetClientInfo, NetWMPid, NetLast }; /* EWMH atoms */
 enum { WMProtocols, WMDelete, WMState, WMTakeFocus, WMLast }; /* default atoms */
+enum { MatchAny, MatchExact, MatchGlob, MatchRegex }; /* rule patterns */
+enum { PropNetWMName, PropWMName, PropTransientFor, PropClass, PropNetWMState,
+    PropNetWMWindowType, PropNormalHints, PropHints, PropClientInfo,
+    PropPid, PropLast }; /* properties manage() reads */
 enum { ClkTagBar, ClkLtSymbol, ClkStatusText, ClkWinTitle,
     ClkClientWin, ClkRootWin, ClkLast }; /* clicks */
 
@@ -98,22 +140,62 @@ typedef struct {
 
 typedef struct Monitor Monitor;
 typedef struct Client Client;
-struct Client {
-	char name[256];
+
+/* what layouts, focus and the bar never walk the client lists for */
+typedef struct {
+	char *name;
+	const char *class, *instance; /* interned */
+	unsigned int rulekey;  /* which rules matched, to spot changes */
+	unsigned int sessionpos; /* 1-based place in a loaded session, 0 if none */
+	Atom homeoutput;       /* unplugged monitor to return to, or None */
+	int namestale;         /* title changed since it was last fetched */
+	int namerules;         /* title changed, rules not yet rerun */
+	long namefetched;      /* ms, see nowms() */
+	XWMHints wmh;          /* last WM_HINTS seen or written */
+	int haswmh;
+	int wmhsent;           /* own writes whose PropertyNotify is due */
+	pid_t pid;             /* _NET_WM_PID, 0 if unknown */
+	int isterminal, noswallow;
+	Client *swallowing;    /* terminal hidden behind this client */
 	float mina, maxa;
-	int x, y, w, h;
-	int oldx, oldy, oldw, oldh;
 	int basew, baseh, incw, inch, maxw, maxh, minw, minh, hintsvalid;
-	int bw, oldbw;
-	unsigned int tags;
-	int isfixed, isfloating, isurgent, neverfocus, oldstate, isfullscreen;
-	Client *next;
+} ClientInfo;
+
+/* kept small and in slabs so list walks stay in few cache lines; the
+ * fields read on every walk come first */
+struct Client {
+	Client *next;         /* also links the free clients */
 	Client *snext;
 	Monitor *mon;
+	unsigned int tags;
+	unsigned int row;     /* inner tag within each of the tags' columns */
+	int x, y, w, h;
+	int bw;
+	int isfixed, isfloating, isurgent, neverfocus, oldstate, isfullscreen;
 	Window win;
+	ClientInfo *info;
+	int ax, ay, aw, ah;   /* geometry currently on screen */
+	int fx, fy, fw, fh;   /* animation start */
+	int tx, ty, tw, th;   /* animation target */
+	int animframe;        /* frames left to animate, 0 when idle */
+	int oldx, oldy, oldw, oldh;
+	int oldbw;
 	ClientState prevstate;
 };
 
+typedef struct Slab Slab;
+struct Slab {
+	Slab *next;
+	Client c[SLABSIZE];
+	ClientInfo info[SLABSIZE];
+};
+
+typedef struct Interned Interned;
+struct Interned {
+	Interned *next;
+	char s[];
+};
+
 typedef struct {
 	unsigned int mod;
 	KeySym keysym;
@@ -126,6 +208,12 @@ typedef struct {
 	void (*arrange)(Monitor *);
 } Layout;
 
+typedef struct {
+	unsigned int *count;  /* clients per inner tag */
+	unsigned int len;     /* inner tags allocated in count */
+	unsigned int row;     /* inner tag last shown in this column */
+} Column;
+
 struct Monitor {
 	char ltsymbol[16];
 	char lastltsymbol[16];
@@ -136,9 +224,15 @@ struct Monitor {
 	int mx, my, mw, mh;   /* screen size */
 	int wx, wy, ww, wh;   /* window area  */
 	int gappx;            /* gaps between windows */
+	int refresh;          /* refresh rate in Hz, paces animations */
+	Atom output;          /* RandR monitor name, None without RandR 1.5 */
+	int geomdirty;        /* to be arranged by updatemons() */
+	Window edgewin[5];    /* InputOnly backdrop and edge strips */
 	unsigned int seltags;
 	unsigned int sellt;
 	unsigned int tagset[2];
+	unsigned int row[2];  /* inner tag shown with each tagset */
+	Column *cols;         /* one per tag, the grid's vertical axis */
 	TagState tagstate;
 	int showbar;
 	int topbar;
@@ -158,72 +252,272 @@ typedef struct {
 	const char *title;
 	unsigned int tags;
 	int isfloating;
+	int isterminal;
+	int noswallow;
 	int monitor;
 } Rule;
 
+typedef struct {
+	const char *name;     /* the instance its rule matches */
+	const void *cmd;
+} Sp;
+
+typedef struct {
+	const void *cmd;
+	unsigned int n;       /* instances kept started */
+} Pool;
+
+/* a window a loaded session waits for, hashed by class and instance */
+typedef struct {
+	const char *class, *instance; /* interned, compared by address */
+	pid_t pid;            /* of the relaunched command */
+	pid_t savedpid;       /* at save time, to start shared processes once */
+	int mon, isfloating, x, y, w, h;
+	unsigned int tags, row, pos;
+	int used;
+	unsigned int next;    /* 1-based index of the next in the bucket */
+} SessionEntry;
+
+typedef struct {
+	int type;
+	const char *str;
+	regex_t re;
+} Pattern;
+
+typedef struct {
+	Pattern class, instance, title;
+	int next;             /* next rule in the same bucket, plus one */
+} RuleIndex;
+
+typedef struct {
+	Window win;
+	int dead;             /* destroyed before its replies were read */
+	Client *c;
+	xcb_get_window_attributes_cookie_t attr;
+	xcb_get_geometry_cookie_t geom;
+	struct timespec requested; /* when its MapRequest came in */
+	xcb_get_property_cookie_t prop[PropLast];
+} Pending;
+
+typedef struct {
+	Window win;
+	XWindowAttributes wa;
+	char name[256];
+	char class[256], instance[256];
+	int hasclass;
+	Window trans;
+	Atom state, wtype;
+	XSizeHints size;
+	XWMHints wmh;
+	int haswmh;
+	long info[3];
+	int ninfo;
+	pid_t pid;
+} WinProps;
+
+typedef struct {
+	pid_t pid;
+	int pidfd;            /* in the epoll set, readable once it exits */
+	const char *cmd;      /* argv[0], interned */
+	struct timespec started;
+	int launched;         /* its first window was seen, or not timed */
+} Child;
+
+typedef struct {
+	const char *name;
+	const char *const *cmd;
+	pid_t pid;            /* 0 when not running */
+	int state;
+	unsigned int restarts; /* crashes since it last ran SUPSTABLE ms */
+	long started, retry;  /* ms, see nowms() */
+} Supervised;
+
+/* the state self_restart() hands to the next image: a SnapHeader, its
+ * SnapSup records, then per monitor a SnapMon followed by its clients,
+ * each a SnapClient and its name, class and instance strings, and last
+ * whatever ipc_handoff() wrote */
+typedef struct {
+	char magic[8];
+	uint32_t monsize, clientsize; /* catch a rebuilt dwm with other records */
+	uint32_t spmask, poolmask;    /* or other scratchpads and pools */
+	uint32_t nmons, nsup, selmon;
+	uint32_t ipcoff;
+} SnapHeader;
+
+typedef struct {
+	int32_t pid, state, restarts;
+} SnapSup;
+
+typedef struct {
+	float mfact;
+	int32_t nmaster, gappx, showbar, topbar;
+	uint32_t seltags, sellt, tagset[2], row[2], lt[2];
+	uint32_t colrow[32];
+	uint32_t sel, nclients;
+	int32_t tagstate[3];  /* what IPC subscribers last heard */
+	char lastltsymbol[16];
+	uint32_t lastlt, lastsel;
+} SnapMon;
+
+typedef struct {
+	uint32_t win, tags, row, stackpos;
+	uint32_t swallowed;   /* hidden behind the client before it */
+	int32_t x, y, w, h, bw, ax, ay, aw, ah;
+	int32_t oldx, oldy, oldw, oldh, oldbw;
+	int32_t isfixed, isfloating, isurgent, neverfocus, oldstate, isfullscreen;
+	int32_t pid, isterminal, noswallow, haswmh;
+	uint32_t rulekey;
+	XWMHints wmh;
+	ClientState prevstate;
+} SnapClient;
+
+/* the crash journal keeps the same records at fixed places in a mapped
+ * file; titles are left out, they are refetched anyway */
+typedef struct {
+	SnapClient c;
+	char class[64], instance[64];
+} JournalClient;
+
+typedef struct {
+	SnapHeader h;         /* ipcoff unused */
+	char server[128];     /* display, X server and boot it is from */
+	uint32_t clean;       /* set by cleanup() or once loaded, nothing to recover */
+	uint32_t nclients;
+	SnapSup sup[JOURNALSUP];
+	SnapMon mons[JOURNALMONS];
+	JournalClient clients[JOURNALCLIENTS];
+} Journal;
+
+typedef struct {
+	const char *cmd;      /* interned, compared by address */
+	unsigned int n;       /* launches seen, the last LAUNCHSAMPLES kept */
+	float map[LAUNCHSAMPLES];   /* ms from spawn to MapRequest */
+	float shown[LAUNCHSAMPLES]; /* ms from spawn to mapped and configured */
+} Launch;
+
+typedef struct {
+	pid_t pid, ppid;
+	long fetched;         /* ms, see nowms() */
+	unsigned long used;   /* pidclock at the last lookup */
+} PidEntry;
+
 /* function declarations */
-static void applyrules(Client *c);
+static void applyrules(Client *c, const char *class, const char *instance);
+static int applysession(Client *c, pid_t pid);
 static int applysizehints(Client *c, int *x, int *y, int *w, int *h, int interact);
 static void arrange(Monitor *m);
 static void arrangemon(Monitor *m);
+static float animease(float t);
+static void animstart(Client *c, int fx, int fy, int tx, int ty);
+static void animtick(void);
 static void attach(Client *c);
+static void attachsession(Client *c);
 static void attachstack(Client *c);
 static void buttonpress(XEvent *e);
 static void checkotherwm(void);
+static void childadopt(void);
+static Child *childbyfd(int fd);
+static void childsweep(void);
+static Child *childwatch(pid_t pid);
 static void cleanup(void);
 static void cleanupmon(Monitor *mon);
+static Client *clientalloc(void);
+static void clientfree(Client *c);
+static void clientlistadd(Window w);
+static void clientlistremove(Window w);
 static void clientmessage(XEvent *e);
+static const char *clientname(Client *c);
+static void compilepattern(Pattern *p, const char *s);
+static void compilerules(void);
 static void configure(Client *c);
 static void configurenotify(XEvent *e);
 static void configurerequest(XEvent *e);
 static Monitor *createmon(void);
+static void decodetextprop(XTextProperty *prop, char *text, unsigned int size);
 static void destroynotify(XEvent *e);
 static void detach(Client *c);
 static void detachstack(Client *c);
 static Monitor *dirtomon(int dir);
+static void dow_emacs(const Arg *arg);
 static void drawbar(Monitor *m);
 static void drawbars(void);
 static void enqueue(Client *c);
 static void enqueuestack(Client *c);
+static Monitor *edgetomon(Window w);
 static void enternotify(XEvent *e);
 static void expose(XEvent *e);
 static void focus(Client *c);
 static void focusin(XEvent *e);
 static void focusmon(const Arg *arg);
 static void focusstack(const Arg *arg);
+static int fetchprops(Pending *p, WinProps *wp);
 static Atom getatomprop(Client *c, Atom prop);
 static int getrootptr(int *x, int *y);
-static long getstate(Window w);
+static pid_t getparentprocess(pid_t p);
 static int gettextprop(Window w, Atom atom, char *text, unsigned int size);
 static void grabbuttons(Client *c, int focused);
 static void grabkeys(void);
+static void gridadd(Client *c);
+static unsigned int gridclamp(Monitor *m, unsigned int tagset, unsigned int row);
+static void griddel(Client *c);
+static unsigned int gridrow(Monitor *m, unsigned int tagset);
 static int handlexevent(struct epoll_event *ev);
+static void hidepos(Client *c, unsigned int tagset, unsigned int row, int *x, int *y);
 static void incnmaster(const Arg *arg);
+static const char *intern(const char *s);
+static int journalfile(char *path, size_t len);
+static void journalflush(void);
+static void journalload(void);
+static void journalput(void *dst, const void *src, size_t len);
 static void keypress(XEvent *e);
 static void killclient(const Arg *arg);
-static void manage(Window w, XWindowAttributes *wa);
+static void killtag(const Arg *arg);
+static double lap(struct timespec *t);
+static Client *manage(WinProps *wp);
 static void managealtbar(Window win, XWindowAttributes *wa);
+static void manageflush(void);
+static void managerequest(Window w);
 static void mappingnotify(XEvent *e);
 static void maprequest(XEvent *e);
+static unsigned int matchrules(Client *c, const char *class, const char *instance,
+		unsigned int *tags, int *isfloating, Monitor **mon);
 static void monocle(Monitor *m);
 static void motionnotify(XEvent *e);
 static void movemouse(const Arg *arg);
+#if defined(XRANDR) || defined(XINERAMA)
+static void movetomon(Client *c, Monitor *m);
+#endif /* XRANDR || XINERAMA */
 static unsigned int nexttag(void);
 static Client *nexttiled(Client *c);
+static long nowms(void);
+static int patternmatch(const Pattern *p, const char *s);
+static void launchrecord(Client *c, const struct timespec *requested, const struct timespec *shown);
+static int pidfdopen(pid_t pid);
+static void poolfill(void);
+static int poolmatch(pid_t pid);
 static void pop(Client *c);
 static unsigned int prevtag(void);
 static void propertynotify(XEvent *e);
 static void quit(const Arg *arg);
+static void reapchild(Child *ch);
+static void reapplyrules(const Arg *arg);
+static Monitor *pointtomon(int x, int y);
 static Monitor *recttomon(int x, int y, int w, int h);
 static void resize(Client *c, int x, int y, int w, int h, int interact);
 static void resizeclient(Client *c, int x, int y, int w, int h);
 static void resizemouse(const Arg *arg);
 static void restack(Monitor *m);
+static void retag(Client *c, Monitor *m, unsigned int tags);
 static void rotatestack(const Arg *arg);
+static int rrmonitors(void);
 static void run(void);
 static void scan(void);
 static int sendevent(Client *c, Atom proto);
 static void sendmon(Client *c, Monitor *m);
+static void sendprotocol(Client *c, Atom proto);
+static int sessionfile(char *path, size_t len);
+static void sessionload(const Arg *arg);
+static void sessionsave(const Arg *arg);
 static void setclientstate(Client *c, long state);
 static void setclienttagprop(Client *c);
 static void setfocus(Client *c);
@@ -232,43 +526,84 @@ static void setgaps(const Arg *arg);
 static void setlayout(const Arg *arg);
 static void setlayoutsafe(const Arg *arg);
 static void setmfact(const Arg *arg);
+static void setsizehints(Client *c, XSizeHints *size);
 static void setup(void);
 static void setupepoll(void);
 static void seturgent(Client *c, int urg);
+static void setwindowtype(Client *c, Atom state, Atom wtype);
+static void setwmhints(Client *c, XWMHints *wmh);
 static void showhide(Client *c);
+static void snapclient(Client *p, Client *c, SnapClient *sc);
+static void snapheader(SnapHeader *h);
+static void snapmon(Monitor *m, SnapMon *sm);
+static void snapshotload(void);
+static int snapshotread(size_t *off, void *dst, size_t len);
+static unsigned int snapshotrestore(Window *wins, unsigned int num);
+static const char *snapshotstr(size_t *off);
+static int snapshotwrite(void);
+static void snapsup(Supervised *s, SnapSup *ss);
 static void spawn(const Arg *arg);
 static void spawnbar();
+static pid_t spawnpid(const void *cmd);
+static void spawnpool(const Arg *arg);
+static void spawnscratch(void);
+static unsigned int strhash(const char *s);
+static void supervise(const char *name, const char *const *cmd);
+static void supervisearm(void);
+static void supervisebar(void);
+static void supervisereap(pid_t pid, int status);
+static void superviserun(Supervised *s);
+static void supervisetick(void);
+static void swallow(Client *p, Client *c);
+static Client *swallowingclient(Window w);
+static void swapmon(const Arg *arg);
 static void tag(const Arg *arg);
+static void tagclass(const Arg *args, int argc);
 static void tagmon(const Arg *arg);
+static void tagrow(unsigned int row);
 static void tagtonext(const Arg *arg);
 static void tagtoprev(const Arg *arg);
+static Client *termforwin(Client *c);
 static void tile(Monitor *m);
+static void titlearm(long due);
+static void titledirty(Client *c);
+static void titlerefresh(Client *c);
+static void titletick(void);
 static void togglebar(const Arg *arg);
 static void togglefloating(const Arg *arg);
+static void togglescratch(const Arg *arg);
 static void toggletag(const Arg *arg);
 static void toggleview(const Arg *arg);
 static void unfocus(Client *c, int setfocus);
 static void unmanage(Client *c, int destroyed);
 static void unmanagealtbar(Window w);
 static void unmapnotify(XEvent *e);
+static void unswallow(Client *c);
 static void updatecurrentdesktop(void);
 static void updatebarpos(Monitor *m);
 static void updatebars(void);
+static void updateclass(Client *c);
 static void updateclientlist(void);
 static int updategeom(void);
+static void updateedges(void);
+static void updatemonindex(void);
+static void updatemons(void);
 static void updatenumlockmask(void);
+static void updaterefresh(void);
+static void updaterules(Client *c);
 static void updatesizehints(Client *c);
 static void updatestatus(void);
-static void updatetitle(Client *c);
+static int updatetitle(Client *c);
 static void updatewindowtype(Client *c);
 static void updatewmhints(Client *c);
 static void view(const Arg *arg);
+static void viewrow(unsigned int row);
 static void window_set_state(Display *dpy, Window win, long state);
 static void window_map(Display *dpy, Client *c, int deiconify);
 static void window_unmap(Display *dpy, Window win, Window root, int iconify);
+static int windowcmp(const void *a, const void *b);
 static Client *wintoclient(Window w);
 static Monitor *wintomon(Window w);
-static int wmclasscontains(Window win, const char *class, const char *name);
 static int xerror(Display *dpy, XErrorEvent *ee);
 static int xerrordummy(Display *dpy, XErrorEvent *ee);
 static int xerrorstart(Display *dpy, XErrorEvent *ee);
@@ -285,11 +620,13 @@ void setupepoll(void);
 
 // FUNCTIONS
 int cursorOverClient(int x, int y);
-void checkedgeswitch(void);
+void checkedgeswitch(int x, int y);
 void aspectresize(const Arg *arg);
 void smartresizegaps(const Arg *arg);
 void applyrememberedsize(Client *c);
-void viewvertical(const Arg *arg);
+
+void tagup(const Arg *arg);
+void tagdown(const Arg *arg);
 
 void viewup(const Arg *arg);
 void viewdown(const Arg *arg);
@@ -298,8 +635,6 @@ void viewprev(const Arg *arg);
 
 
 // VARIABLES
-static int isVerticalMove = 0;  // 0 for horizontal, 1 for vertical
-
 int remembered_width = 0;
 int remembered_height = 0;
 
@@ -329,12 +664,65 @@ static void (*handler[LASTEvent]) (XEvent *) = {
 	[UnmapNotify] = unmapnotify
 };
 static Atom wmatom[WMLast], netatom[NetLast];
-static int epoll_fd;
+static int epoll_fd = -1;   /* until setupepoll(), spawnpid() checks it */
 static int dpy_fd;
+static int anim_fd = -1;
+static int animarmed = 0;    /* frame timer is running */
+static int title_fd = -1;
+static long titledue;        /* title timer deadline, 0 when disarmed */
+static int animview = 0;     /* slide the next showhide() */
+static int animarrange = 0;  /* animate resizes done by the layout */
 static int running = 1;
 static Cur *cursor[CurLast];
 static Clr **scheme;
 static Display *dpy;
+static xcb_connection_t *xcon;
+static Pending *pending;
+static unsigned int npending, pendingcap;
+static RuleIndex *ruleidx;
+static int *rulehead[2];          /* buckets on exact class and instance */
+static unsigned int rulebuckets;
+static int *rulepatterns;         /* rules keyed on neither */
+static unsigned int nrulepatterns;
+static int ruletitles;            /* some rule looks at the title */
+static Slab *slabs;
+static Client *freeclients;
+static Interned *interned[64];
+static unsigned int scratchshow; /* scratchpads to show once they map */
+static struct { pid_t pid; unsigned int pool; long started; } poolstarting[16];
+static unsigned int npoolstarting;
+static SessionEntry *sessions;
+static unsigned int nsessions;
+static unsigned int sessionhead[64];
+static long sessionloaded;
+static Child *children;           /* what we spawned and still runs */
+static unsigned int nchildren, childrencap;
+static Launch *launches;
+static unsigned int nlaunches;
+static Supervised *supervised;    /* autostart and the bar, restarted on crashes */
+static unsigned int nsupervised;
+static int barsup = -1;           /* supervised[] entry of altbarcmd */
+static Window lostbar;            /* external bar last unmapped */
+static int sup_fd = -1;
+static char *snapbuf;             /* what the previous image left us */
+static size_t snapbuflen;
+#ifdef XRANDR
+static int rrbase = -1;           /* RandR 1.5 event base, -1 without */
+#endif /* XRANDR */
+static int monsdirty;
+static Monitor *parkedmons;       /* unplugged, kept for when they return */
+static Monitor **monindex;        /* mons by left edge, see pointtomon() */
+static unsigned int nmonindex;
+static Monitor *ptrmon;           /* where pointtomon() last found the pointer */
+static Journal *journal;          /* mapped journalfile(), NULL without one */
+static int journaldirty;
+static int havepidfd;
+extern char **environ;
+static PidEntry pidcache[128];    /* parents of the processes we looked at */
+static unsigned long pidclock;
+static Window *clientlist, *stacklist;  /* mapping and bottom to top order */
+static unsigned int nclientlist, clientlistcap;
+static int clientlistdirty, stacklistdirty;
 static Drw *drw;
 static Monitor *mons, *selmon, *lastselmon;
 static Window root, wmcheckwin;
@@ -353,69 +741,181 @@ static Window root, wmcheckwin;
 /* compile-time check if all tags fit into an unsigned int bit array. */
 struct NumTags { char limitexceeded[LENGTH(tags) > 31 ? -1 : 1]; };
 
-/* dwm will keep pid's of processes from autostart array and kill them at quit */
-static pid_t *autostart_pids;
-static size_t autostart_len;
-
-/* execute command from autostart array */
+/* start the autostart commands under the supervisor, which restarts the
+ * ones that crash and kills them all at quit */
 static void
 autostart_exec() {
 	const char *const *p;
-	size_t i = 0;
-
-	/* count entries */
-	for (p = autostart; *p; autostart_len++, p++)
-		while (*++p);
 
-	autostart_pids = malloc(autostart_len * sizeof(pid_t));
-	for (p = autostart; *p; i++, p++) {
-		if ((autostart_pids[i] = fork()) == 0) {
-			setsid();
-			execvp(*p, (char *const *)p);
-			fprintf(stderr, "dwm: execvp %s\n", *p);
-			perror(" failed");
-			_exit(EXIT_FAILURE);
-		}
+	for (p = autostart; *p; p++) {
+		supervise(*p, p);
 		/* skip arguments */
 		while (*++p);
 	}
 }
 
 /* function implementations */
+/* cubic ease-out: quick start, soft landing */
+float
+animease(float t)
+{
+	t = 1.0 - t;
+	return 1.0 - t * t * t;
+}
+
+/* animate c from (fx, fy) to (tx, ty), resizing it from its on-screen
+ * size to its current size on the way */
 void
-applyrules(Client *c)
+animstart(Client *c, int fx, int fy, int tx, int ty)
 {
-	const char *class, *instance;
-	unsigned int i;
-	const Rule *r;
+	struct itimerspec its = {{0}};
+
+	if (!c->aw || !c->ah) {
+		c->aw = c->w;
+		c->ah = c->h;
+	}
+	if (c->animframe) { /* overlapping transition, continue from here */
+		fx = c->ax;
+		fy = c->ay;
+	}
+	c->fx = fx;
+	c->fy = fy;
+	c->fw = c->aw;
+	c->fh = c->ah;
+	c->tx = tx;
+	c->ty = ty;
+	c->tw = c->w;
+	c->th = c->h;
+	c->animframe = animframes;
+	XMoveWindow(dpy, c->win, c->ax = fx, c->ay = fy);
+	if (animarmed)
+		return;
+	/* one frame per vertical refresh of the monitor we slide on */
+	its.it_value.tv_nsec = 1000000000L / MAX(c->mon->refresh, 2);
+	its.it_interval = its.it_value;
+	if (timerfd_settime(anim_fd, 0, &its, NULL) == 0)
+		animarmed = 1;
+}
+
+void
+animtick(void)
+{
+	unsigned long long n;
+	int w, h, busy = 0, landed = 0;
+	float t;
+	Client *c;
 	Monitor *m;
-	XClassHint ch = { NULL, NULL };
+	struct itimerspec its = {{0}};
+#ifdef _DEBUG
+	int nc = 0;
+	struct timespec t0, t1;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t0);
+#endif
+
+	if (read(anim_fd, &n, sizeof n) != sizeof n)
+		return;
+	/* n > 1 means we were late, drop the frames we missed */
+	for (m = mons; m; m = m->next)
+		for (c = m->clients; c; c = c->next) {
+			if (!c->animframe)
+				continue;
+			c->animframe = n >= c->animframe ? 0 : c->animframe - n;
+			t = animease(1.0 - (float)c->animframe / animframes);
+			c->ax = c->fx + (c->tx - c->fx) * t;
+			c->ay = c->fy + (c->ty - c->fy) * t;
+			w = c->fw + (c->tw - c->fw) * t;
+			h = c->fh + (c->th - c->fh) * t;
+			/* clients with resize increments (terminals reflowing
+			 * their grid) are slow to repaint, they only get the
+			 * final size */
+			if (c->animframe && (c->info->incw || c->info->inch)) {
+				w = c->aw;
+				h = c->ah;
+			}
+			if (w != c->aw || h != c->ah)
+				XMoveResizeWindow(dpy, c->win, c->ax, c->ay, c->aw = w, c->ah = h);
+			else
+				XMoveWindow(dpy, c->win, c->ax, c->ay);
+			/* one synthetic configure once it landed, none in between */
+			if (!c->animframe) {
+				configure(c);
+				landed = 1;
+			}
+			busy |= c->animframe;
+#ifdef _DEBUG
+			nc++;
+#endif
+		}
+	/* like resizeclient(), wait for the final geometry to be applied */
+	if (landed)
+		XSync(dpy, False);
+	else
+		XFlush(dpy);
+#ifdef _DEBUG
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t1);
+	DEBUG("animation frame: %d clients, %ld ns cpu\n", nc,
+		(t1.tv_sec - t0.tv_sec) * 1000000000L + t1.tv_nsec - t0.tv_nsec);
+#endif
+	if (!busy) {
+		timerfd_settime(anim_fd, 0, &its, NULL);
+		animarmed = 0;
+	}
+}
+
+void
+applyrules(Client *c, const char *class, const char *instance)
+{
+	unsigned int sp;
 
 	/* rule matching */
 	c->isfloating = 0;
 	c->tags = 0;
-	XGetClassHint(dpy, c->win, &ch);
-	class    = ch.res_class ? ch.res_class : broken;
-	instance = ch.res_name  ? ch.res_name  : broken;
+	c->info->rulekey = matchrules(c, class, instance, &c->tags, &c->isfloating, &c->mon);
+	/* scratchpads start out hidden on their own tag */
+	if ((sp = c->tags & SPTAGMASK)) {
+		c->tags = sp & scratchshow ? sp | c->mon->tagset[c->mon->seltags] : sp;
+		scratchshow &= ~sp;
+	} else
+		c->tags = c->tags & TAGMASK ? c->tags & TAGMASK : c->mon->tagset[c->mon->seltags];
+	c->row = gridrow(c->mon, c->tags);
+}
 
-	for (i = 0; i < LENGTH(rules); i++) {
-		r = &rules[i];
-		if ((!r->title || strstr(c->name, r->title))
-		&& (!r->class || strstr(class, r->class))
-		&& (!r->instance || strstr(instance, r->instance)))
-		{
-			c->isfloating = r->isfloating;
-			c->tags |= r->tags;
-			for (m = mons; m && m->num != r->monitor; m = m->next);
-			if (m)
-				c->mon = m;
-		}
+/* places c where the loaded session had it, bypassing the rules; a window
+ * of the process that was relaunched for it wins over one that merely
+ * shares its class and instance */
+int
+applysession(Client *c, pid_t pid)
+{
+	SessionEntry *e, *best = NULL;
+	Monitor *m;
+	unsigned int k;
+
+	if (!nsessions || nowms() - sessionloaded > SESSIONTIMEOUT)
+		return 0;
+	k = sessionhead[(strhash(c->info->class) ^ strhash(c->info->instance)) & (LENGTH(sessionhead) - 1)];
+	for (; k; k = e->next) {
+		e = &sessions[k - 1];
+		if (e->used || e->class != c->info->class || e->instance != c->info->instance)
+			continue;
+		if (!best || (pid && e->pid == pid && best->pid != pid))
+			best = e;
 	}
-	if (ch.res_class)
-		XFree(ch.res_class);
-	if (ch.res_name)
-		XFree(ch.res_name);
-	c->tags = c->tags & TAGMASK ? c->tags & TAGMASK : c->mon->tagset[c->mon->seltags];
+	if (!(e = best))
+		return 0;
+	e->used = 1;
+	for (m = mons; m && m->num != e->mon; m = m->next);
+	c->mon = m ? m : selmon;
+	c->tags = e->tags & TAGMASK ? e->tags & TAGMASK : c->mon->tagset[c->mon->seltags];
+	c->row = gridclamp(c->mon, c->tags, e->row);
+	c->info->sessionpos = e->pos + 1;
+	if ((c->isfloating = e->isfloating)) {
+		c->x = e->x;
+		c->y = e->y;
+		c->w = e->w;
+		c->h = e->h;
+	}
+	return 1;
 }
 
 int
@@ -451,37 +951,37 @@ applysizehints(Client *c, int *x, int *y, int *w, int *h, int interact)
 	if (*w < bh)
 		*w = bh;
 	if (resizehints || c->isfloating || !c->mon->lt[c->mon->sellt]->arrange) {
-		if (!c->hintsvalid)
+		if (!c->info->hintsvalid)
 			updatesizehints(c);
 		/* see last two sentences in ICCCM 4.1.2.3 */
-		baseismin = c->basew == c->minw && c->baseh == c->minh;
+		baseismin = c->info->basew == c->info->minw && c->info->baseh == c->info->minh;
 		if (!baseismin) { /* temporarily remove base dimensions */
-			*w -= c->basew;
-			*h -= c->baseh;
+			*w -= c->info->basew;
+			*h -= c->info->baseh;
 		}
 		/* adjust for aspect limits */
-		if (c->mina > 0 && c->maxa > 0) {
-			if (c->maxa < (float)*w / *h)
-				*w = *h * c->maxa + 0.5;
-			else if (c->mina < (float)*h / *w)
-				*h = *w * c->mina + 0.5;
+		if (c->info->mina > 0 && c->info->maxa > 0) {
+			if (c->info->maxa < (float)*w / *h)
+				*w = *h * c->info->maxa + 0.5;
+			else if (c->info->mina < (float)*h / *w)
+				*h = *w * c->info->mina + 0.5;
 		}
 		if (baseismin) { /* increment calculation requires this */
-			*w -= c->basew;
-			*h -= c->baseh;
+			*w -= c->info->basew;
+			*h -= c->info->baseh;
 		}
 		/* adjust for increment value */
-		if (c->incw)
-			*w -= *w % c->incw;
-		if (c->inch)
-			*h -= *h % c->inch;
+		if (c->info->incw)
+			*w -= *w % c->info->incw;
+		if (c->info->inch)
+			*h -= *h % c->info->inch;
 		/* restore base dimensions */
-		*w = MAX(*w + c->basew, c->minw);
-		*h = MAX(*h + c->baseh, c->minh);
-		if (c->maxw)
-			*w = MIN(*w, c->maxw);
-		if (c->maxh)
-			*h = MIN(*h, c->maxh);
+		*w = MAX(*w + c->info->basew, c->info->minw);
+		*h = MAX(*h + c->info->baseh, c->info->minh);
+		if (c->info->maxw)
+			*w = MIN(*w, c->info->maxw);
+		if (c->info->maxh)
+			*h = MIN(*h, c->info->maxh);
 	}
 	return *x != c->x || *y != c->y || *w != c->w || *h != c->h;
 }
@@ -493,6 +993,8 @@ arrange(Monitor *m)
 		showhide(m->stack);
 	else for (m = mons; m; m = m->next)
 		showhide(m->stack);
+	animview = 0;
+	journaldirty = 1;
 	if (m) {
 		arrangemon(m);
 		restack(m);
@@ -504,8 +1006,11 @@ void
 arrangemon(Monitor *m)
 {
 	strncpy(m->ltsymbol, m->lt[m->sellt]->symbol, sizeof m->ltsymbol);
-	if (m->lt[m->sellt]->arrange)
+	if (m->lt[m->sellt]->arrange) {
+		animarrange = running && animlayout && animframes > 0 && anim_fd != -1;
 		m->lt[m->sellt]->arrange(m);
+		animarrange = 0;
+	}
 }
 
 void
@@ -515,11 +1020,26 @@ attach(Client *c)
 	c->mon->clients = c;
 }
 
+/* keeps the clients of a loaded session in their saved order, whatever
+ * order their windows map in */
+void
+attachsession(Client *c)
+{
+	Client **tc;
+
+	for (tc = &c->mon->clients; *tc; tc = &(*tc)->next)
+		if ((*tc)->info->sessionpos > c->info->sessionpos)
+			break;
+	c->next = *tc;
+	*tc = c;
+}
+
 void
 attachstack(Client *c)
 {
 	c->snext = c->mon->stack;
 	c->mon->stack = c;
+	stacklistdirty = 1;
 }
 
 void
@@ -575,14 +1095,93 @@ checkotherwm(void)
 	XSync(dpy, False);
 }
 
+/* picks up the children this process already had: the ones a restart
+ * carried over, or whatever the shell that exec'd us left behind */
+void
+childadopt(void)
+{
+	char path[64];
+	FILE *f;
+	int pid;
+	unsigned int i;
+
+	snprintf(path, sizeof path, "/proc/self/task/%d/children", (int)getpid());
+	if (!(f = fopen(path, "r")))
+		return;
+	while (fscanf(f, "%d", &pid) == 1) {
+		for (i = 0; i < nchildren && children[i].pid != pid; i++);
+		if (i == nchildren)
+			childwatch(pid);
+	}
+	fclose(f);
+}
+
+Child *
+childbyfd(int fd)
+{
+	unsigned int i;
+
+	for (i = 0; i < nchildren; i++)
+		if (children[i].pidfd == fd)
+			return &children[i];
+	return NULL;
+}
+
+/* reaps the children nobody watches: those childadopt() could not find
+ * and those without a pidfd; a watched one is left to reapchild() */
+void
+childsweep(void)
+{
+	siginfo_t si;
+	unsigned int i;
+	int status;
+
+	for (;;) {
+		si.si_pid = 0;
+		if (waitid(P_ALL, 0, &si, WEXITED|WNOHANG|WNOWAIT) == -1 || !si.si_pid)
+			return;
+		for (i = 0; i < nchildren && children[i].pid != si.si_pid; i++);
+		if (i < nchildren || waitpid(si.si_pid, &status, WNOHANG) != si.si_pid)
+			return;
+		supervisereap(si.si_pid, status);
+	}
+}
+
+Child *
+childwatch(pid_t pid)
+{
+	struct epoll_event ev = { .events = EPOLLIN };
+	int fd;
+
+	if ((fd = pidfdopen(pid)) == -1)
+		return NULL;
+	if (nchildren == childrencap) {
+		childrencap = childrencap ? childrencap * 2 : 16;
+		if (!(children = realloc(children, childrencap * sizeof(Child))))
+			die("realloc:");
+	}
+	memset(&children[nchildren], 0, sizeof(Child));
+	children[nchildren].pid = pid;
+	children[nchildren].pidfd = fd;
+	ev.data.fd = fd;
+	if (epoll_fd != -1)
+		epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+	return &children[nchildren++];
+}
+
 void
 cleanup(void)
 {
 	Arg a = {.ui = ~0};
 	Layout foo = { "", NULL };
+	Client *c;
 	Monitor *m;
 	size_t i;
 
+	/* drop slides in flight so windows are left where they belong */
+	for (m = mons; m; m = m->next)
+		for (c = m->clients; c; c = c->next)
+			c->animframe = 0;
 	view(&a);
 	selmon->lt[selmon->sellt] = &foo;
 	for (m = mons; m; m = m->next)
@@ -591,11 +1190,44 @@ cleanup(void)
 	XUngrabKey(dpy, AnyKey, AnyModifier, root);
 	while (mons)
 		cleanupmon(mons);
+	while (parkedmons) {
+		mons = parkedmons;
+		parkedmons = parkedmons->next;
+		mons->next = NULL;
+		cleanupmon(mons);
+	}
 	for (i = 0; i < CurLast; i++)
 		drw_cur_free(drw, cursor[i]);
 	for (i = 0; i < LENGTH(colors); i++)
 		free(scheme[i]);
 	free(scheme);
+	free(pending);
+	free(clientlist);
+	free(stacklist);
+	free(monindex);
+	for (i = 0; i < LENGTH(rules); i++) {
+		if (ruleidx[i].class.type == MatchRegex)
+			regfree(&ruleidx[i].class.re);
+		if (ruleidx[i].instance.type == MatchRegex)
+			regfree(&ruleidx[i].instance.re);
+		if (ruleidx[i].title.type == MatchRegex)
+			regfree(&ruleidx[i].title.re);
+	}
+	free(ruleidx);
+	free(rulehead[0]);
+	free(rulehead[1]);
+	free(rulepatterns);
+	while (slabs) {
+		Slab *s = slabs->next;
+		free(slabs);
+		slabs = s;
+	}
+	for (i = 0; i < LENGTH(interned); i++)
+		while (interned[i]) {
+			Interned *in = interned[i]->next;
+			free(interned[i]);
+			interned[i] = in;
+		}
 	XDestroyWindow(dpy, wmcheckwin);
 	drw_free(drw);
 	XSync(dpy, False);
@@ -604,6 +1236,21 @@ cleanup(void)
 
 	ipc_cleanup();
 
+	if (anim_fd != -1)
+		close(anim_fd);
+	if (title_fd != -1)
+		close(title_fd);
+	for (i = 0; i < nchildren; i++)
+		close(children[i].pidfd);
+	free(children);
+	free(launches);
+	free(supervised);
+	if (sup_fd != -1)
+		close(sup_fd);
+	if (journal) {
+		journal->clean = 1;
+		munmap(journal, sizeof(Journal));
+	}
 	if (close(epoll_fd) < 0) {
 			fprintf(stderr, "Failed to close epoll file descriptor\n");
 	}
@@ -613,6 +1260,7 @@ void
 cleanupmon(Monitor *mon)
 {
 	Monitor *m;
+	unsigned int i;
 
 	if (mon == mons)
 		mons = mons->next;
@@ -620,13 +1268,82 @@ cleanupmon(Monitor *mon)
 		for (m = mons; m && m->next != mon; m = m->next);
 		m->next = mon->next;
 	}
-	if (!usealtbar) {
+	if (!usealtbar && mon->barwin) {
 		XUnmapWindow(dpy, mon->barwin);
 		XDestroyWindow(dpy, mon->barwin);
 	}
+	for (i = 0; i < LENGTH(mon->edgewin); i++)
+		if (mon->edgewin[i])
+			XDestroyWindow(dpy, mon->edgewin[i]);
+	for (i = 0; i < LENGTH(tags); i++)
+		free(mon->cols[i].count);
+	free(mon->cols);
 	free(mon);
 }
 
+Client *
+clientalloc(void)
+{
+	Slab *s;
+	Client *c;
+	ClientInfo *info;
+	int i;
+
+	if (!freeclients) {
+		s = ecalloc(1, sizeof(Slab));
+		s->next = slabs;
+		slabs = s;
+		for (i = SLABSIZE - 1; i >= 0; i--) {
+			s->c[i].info = &s->info[i];
+			s->c[i].next = freeclients;
+			freeclients = &s->c[i];
+		}
+	}
+	c = freeclients;
+	freeclients = c->next;
+	info = c->info;
+	memset(c, 0, sizeof(Client));
+	memset(info, 0, sizeof(ClientInfo));
+	c->info = info;
+	return c;
+}
+
+void
+clientfree(Client *c)
+{
+	free(c->info->name);
+	c->info->name = NULL;
+	c->next = freeclients;
+	freeclients = c;
+}
+
+/* the EWMH client lists are kept here and written out by
+ * updateclientlist() at most once per wakeup */
+void
+clientlistadd(Window w)
+{
+	if (nclientlist == clientlistcap) {
+		clientlistcap = clientlistcap ? clientlistcap * 2 : 64;
+		if (!(clientlist = realloc(clientlist, clientlistcap * sizeof(Window)))
+		|| !(stacklist = realloc(stacklist, clientlistcap * sizeof(Window))))
+			die("realloc:");
+	}
+	clientlist[nclientlist++] = w;
+	clientlistdirty = stacklistdirty = journaldirty = 1;
+}
+
+void
+clientlistremove(Window w)
+{
+	unsigned int i;
+
+	for (i = 0; i < nclientlist && clientlist[i] != w; i++);
+	if (i == nclientlist)
+		return;
+	memmove(&clientlist[i], &clientlist[i + 1], (--nclientlist - i) * sizeof(Window));
+	clientlistdirty = stacklistdirty = journaldirty = 1;
+}
+
 void
 clientmessage(XEvent *e)
 {
@@ -646,6 +1363,73 @@ clientmessage(XEvent *e)
 	}
 }
 
+/* the title as of now: a stale one is fetched on the spot, callers that
+ * ask for it are not rate limited */
+const char *
+clientname(Client *c)
+{
+	if (c->info->namestale)
+		updatetitle(c);
+	return c->info->name;
+}
+
+/* a rule string is a /regex/, a glob when it has any of *?[ in it, and
+ * has to match exactly otherwise */
+void
+compilepattern(Pattern *p, const char *s)
+{
+	size_t n;
+	char *re;
+
+	p->str = s;
+	if (!s)
+		p->type = MatchAny;
+	else if ((n = strlen(s)) > 1 && s[0] == '/' && s[n - 1] == '/') {
+		re = ecalloc(n - 1, 1);
+		memcpy(re, s + 1, n - 2);
+		if (regcomp(&p->re, re, REG_EXTENDED | REG_NOSUB))
+			die("dwm: invalid rule regex '%s'", s);
+		free(re);
+		p->type = MatchRegex;
+	} else if (strpbrk(s, "*?["))
+		p->type = MatchGlob;
+	else
+		p->type = MatchExact;
+}
+
+/* index rules[] once: a rule with an exact class goes in the class bucket,
+ * else one with an exact instance in the instance bucket, the rest are
+ * tried for every window */
+void
+compilerules(void)
+{
+	unsigned int i, h;
+	RuleIndex *ri;
+
+	for (rulebuckets = 8; rulebuckets < 2 * LENGTH(rules); rulebuckets *= 2);
+	rulehead[0] = ecalloc(rulebuckets, sizeof(int));
+	rulehead[1] = ecalloc(rulebuckets, sizeof(int));
+	ruleidx = ecalloc(LENGTH(rules), sizeof(RuleIndex));
+	rulepatterns = ecalloc(LENGTH(rules), sizeof(int));
+	for (i = 0; i < LENGTH(rules); i++) {
+		ri = &ruleidx[i];
+		compilepattern(&ri->class, rules[i].class);
+		compilepattern(&ri->instance, rules[i].instance);
+		compilepattern(&ri->title, rules[i].title);
+		ruletitles |= ri->title.type != MatchAny;
+		if (ri->class.type == MatchExact) {
+			h = strhash(rules[i].class) & (rulebuckets - 1);
+			ri->next = rulehead[0][h];
+			rulehead[0][h] = i + 1;
+		} else if (ri->instance.type == MatchExact) {
+			h = strhash(rules[i].instance) & (rulebuckets - 1);
+			ri->next = rulehead[1][h];
+			rulehead[1][h] = i + 1;
+		} else
+			rulepatterns[nrulepatterns++] = i;
+	}
+}
+
 void
 configure(Client *c)
 {
@@ -669,27 +1453,19 @@ void
 configurenotify(XEvent *e)
 {
 	Monitor *m;
-	Client *c;
 	XConfigureEvent *ev = &e->xconfigure;
-	int dirty;
 
-	/* TODO: updategeom handling sucks, needs to be simplified */
+	/* monitors are compared once the event queue is drained, see
+	 * updatemons() */
 	if (ev->window == root) {
-		dirty = (sw != ev->width || sh != ev->height);
-		sw = ev->width;
-		sh = ev->height;
-		if (updategeom() || dirty) {
+		if (sw != ev->width || sh != ev->height) {
+			sw = ev->width;
+			sh = ev->height;
 			drw_resize(drw, sw, bh);
-			updatebars();
-			for (m = mons; m; m = m->next) {
-				for (c = m->clients; c; c = c->next)
-					if (c->isfullscreen)
-						resizeclient(c, m->mx, m->my, m->mw, m->mh);
-				XMoveResizeWindow(dpy, m->barwin, m->wx, m->by, m->ww, m->bh);
-			}
-			focus(NULL);
-			arrange(NULL);
+			for (m = mons; m; m = m->next)
+				m->geomdirty = 1;
 		}
+		monsdirty = 1;
 	}
 }
 
@@ -782,6 +1558,8 @@ createmon(void)
 	m->showbar = showbar;
 	m->topbar = topbar;
 	m->gappx = gappx;
+	m->refresh = animrefresh;
+	m->cols = ecalloc(LENGTH(tags), sizeof(Column));
 	m->bh = bh;
 	m->lt[0] = &layouts[0];
 	m->lt[1] = &layouts[1 % LENGTH(layouts)];
@@ -808,17 +1586,48 @@ createmon(void)
 /* 	return m; */
 /* } */
 
+/* prop->value need not be NUL terminated, only prop->nitems bytes are read */
+void
+decodetextprop(XTextProperty *prop, char *text, unsigned int size)
+{
+	char **list = NULL;
+	int n;
+
+	text[0] = '\0';
+	if (prop->encoding == XA_STRING) {
+		strncpy(text, (char *)prop->value, MIN(prop->nitems, size - 1));
+		text[MIN(prop->nitems, size - 1)] = '\0';
+	} else if (XmbTextPropertyToTextList(dpy, prop, &list, &n) >= Success && n > 0 && *list) {
+		strncpy(text, *list, size - 1);
+		XFreeStringList(list);
+	}
+	text[size - 1] = '\0';
+}
+
 void
 destroynotify(XEvent *e)
 {
 	Client *c;
 	Monitor *m;
 	XDestroyWindowEvent *ev = &e->xdestroywindow;
+	unsigned int i;
 
+	for (i = 0; i < npending; i++)
+		if (pending[i].win == ev->window)
+			pending[i].dead = 1;
 	if ((c = wintoclient(ev->window)))
 		unmanage(c, 1);
-	else if ((m = wintomon(ev->window)) && m->barwin == ev->window)
+	else if ((c = swallowingclient(ev->window))) {
+		/* the hidden terminal went away, its window slot stays */
+		clientfree(c->info->swallowing);
+		c->info->swallowing = NULL;
+	} else if ((m = wintomon(ev->window)) && m->barwin == ev->window)
 		unmanagealtbar(ev->window);
+	/* usually unmapped just before, see unmanagealtbar() */
+	if (ev->window == lostbar) {
+		lostbar = None;
+		supervisebar();
+	}
 }
 
 void
@@ -837,6 +1646,7 @@ detachstack(Client *c)
 
 	for (tc = &c->mon->stack; *tc && *tc != c; tc = &(*tc)->snext);
 	*tc = c->snext;
+	stacklistdirty = 1;
 
 	if (c == c->mon->sel) {
 		for (t = c->mon->stack; t && !ISVISIBLE(t); t = t->snext);
@@ -859,6 +1669,14 @@ dirtomon(int dir)
 	return m;
 }
 
+/* unclutter: send every client back to its rule tag, then open emacs */
+void
+dow_emacs(const Arg *arg)
+{
+	reapplyrules(NULL);
+	spawn(&(const Arg){ .v = emacscmd });
+}
+
 void
 drawbar(Monitor *m)
 {
@@ -904,7 +1722,7 @@ drawbar(Monitor *m)
 	if ((w = m->ww - tw - x) > bh) {
 		if (m->sel) {
 			drw_setscheme(drw, scheme[m == selmon ? SchemeSel : SchemeNorm]);
-			drw_text(drw, x, 0, w, bh, lrpad / 2, m->sel->name, 0);
+			drw_text(drw, x, 0, w, bh, lrpad / 2, clientname(m->sel), 0);
 			if (m->sel->isfloating)
 				drw_rect(drw, x + boxs, boxs, boxw, boxw, m->sel->isfixed, 0);
 		} else {
@@ -946,6 +1764,19 @@ enqueuestack(Client *c)
 	}
 }
 
+Monitor *
+edgetomon(Window w)
+{
+	Monitor *m;
+	unsigned int i;
+
+	for (m = mons; m; m = m->next)
+		for (i = 0; i < LENGTH(m->edgewin); i++)
+			if (w == m->edgewin[i])
+				return m;
+	return NULL;
+}
+
 void
 enternotify(XEvent *e)
 {
@@ -955,6 +1786,17 @@ enternotify(XEvent *e)
 
 	if ((ev->mode != NotifyNormal || ev->detail == NotifyInferior) && ev->window != root)
 		return;
+	/* the pointer reached the bare desktop or an edge of a monitor */
+	if ((m = edgetomon(ev->window))) {
+		if (m != selmon) {
+			unfocus(selmon->sel, 1);
+			selmon = m;
+			focus(NULL);
+		}
+		/* on the backdrop, away from the edges, this only rearms them */
+		checkedgeswitch(ev->x_root, ev->y_root);
+		return;
+	}
 	c = wintoclient(ev->window);
 	m = c ? c->mon : wintomon(ev->window);
 	if (m != selmon) {
@@ -975,15 +1817,139 @@ expose(XEvent *e)
 		drawbar(m);
 }
 
-void
-focus(Client *c)
+/* collects the replies managerequest() asked for, returns 0 when the
+ * window is gone or not ours to manage */
+int
+fetchprops(Pending *p, WinProps *wp)
 {
-	if (!c || !ISVISIBLE(c))
-		for (c = selmon->stack; c && !ISVISIBLE(c); c = c->snext);
-	if (selmon->sel && selmon->sel != c)
-		unfocus(selmon->sel, 0);
-	if (c) {
-		if (c->mon != selmon)
+	xcb_get_window_attributes_reply_t *attr;
+	xcb_get_geometry_reply_t *geom;
+	xcb_get_property_reply_t *r[PropLast];
+	xcb_generic_error_t *err;
+	XTextProperty text;
+	uint32_t *v;
+	char *str;
+	int i, n, ok;
+
+	attr = xcb_get_window_attributes_reply(xcon, p->attr, &err);
+	free(err);
+	geom = xcb_get_geometry_reply(xcon, p->geom, &err);
+	free(err);
+	for (i = 0; i < PropLast; i++) {
+		r[i] = xcb_get_property_reply(xcon, p->prop[i], &err);
+		free(err);
+	}
+	if ((ok = !p->dead && attr && geom && !attr->override_redirect)) {
+		memset(wp, 0, sizeof *wp);
+		wp->win = p->win;
+		wp->wa.x = geom->x;
+		wp->wa.y = geom->y;
+		wp->wa.width = geom->width;
+		wp->wa.height = geom->height;
+		wp->wa.border_width = geom->border_width;
+		wp->wa.map_state = attr->map_state;
+
+		for (i = PropNetWMName; i <= PropWMName; i++)
+			if (r[i] && (n = xcb_get_property_value_length(r[i])) > 0) {
+				text.value = xcb_get_property_value(r[i]);
+				text.encoding = r[i]->type;
+				text.format = r[i]->format;
+				text.nitems = n;
+				decodetextprop(&text, wp->name, sizeof wp->name);
+				break;
+			}
+		if (wp->name[0] == '\0') /* hack to mark broken clients */
+			strcpy(wp->name, broken);
+
+		if (r[PropTransientFor] && r[PropTransientFor]->format == 32 && r[PropTransientFor]->value_len)
+			wp->trans = *(uint32_t *)xcb_get_property_value(r[PropTransientFor]);
+
+		/* WM_CLASS is "instance\0class\0" */
+		strcpy(wp->instance, broken);
+		strcpy(wp->class, broken);
+		if (r[PropClass] && (n = xcb_get_property_value_length(r[PropClass])) > 0) {
+			str = xcb_get_property_value(r[PropClass]);
+			i = strnlen(str, n);
+			snprintf(wp->instance, sizeof wp->instance, "%.*s", i, str);
+			if (i < n)
+				snprintf(wp->class, sizeof wp->class, "%.*s",
+					(int)strnlen(str + i + 1, n - i - 1), str + i + 1);
+			wp->hasclass = 1;
+		}
+
+		if (r[PropNetWMState] && r[PropNetWMState]->format == 32 && r[PropNetWMState]->value_len)
+			wp->state = *(uint32_t *)xcb_get_property_value(r[PropNetWMState]);
+		if (r[PropNetWMWindowType] && r[PropNetWMWindowType]->format == 32 && r[PropNetWMWindowType]->value_len)
+			wp->wtype = *(uint32_t *)xcb_get_property_value(r[PropNetWMWindowType]);
+
+		/* the same unpacking XGetWMNormalHints() does */
+		wp->size.flags = PSize;
+		if (r[PropNormalHints] && r[PropNormalHints]->format == 32
+		&& (n = r[PropNormalHints]->value_len) >= 15) {
+			v = xcb_get_property_value(r[PropNormalHints]);
+			wp->size.flags = v[0] & (USPosition|USSize|PAllHints|PBaseSize|PWinGravity);
+			wp->size.min_width = (int32_t)v[5];
+			wp->size.min_height = (int32_t)v[6];
+			wp->size.max_width = (int32_t)v[7];
+			wp->size.max_height = (int32_t)v[8];
+			wp->size.width_inc = (int32_t)v[9];
+			wp->size.height_inc = (int32_t)v[10];
+			wp->size.min_aspect.x = (int32_t)v[11];
+			wp->size.min_aspect.y = (int32_t)v[12];
+			wp->size.max_aspect.x = (int32_t)v[13];
+			wp->size.max_aspect.y = (int32_t)v[14];
+			if (n >= 18) {
+				wp->size.base_width = (int32_t)v[15];
+				wp->size.base_height = (int32_t)v[16];
+				wp->size.win_gravity = (int32_t)v[17];
+			} else
+				wp->size.flags &= ~(PBaseSize|PWinGravity);
+		}
+
+		/* and XGetWMHints() */
+		if (r[PropHints] && r[PropHints]->format == 32 && (n = r[PropHints]->value_len) >= 8) {
+			v = xcb_get_property_value(r[PropHints]);
+			wp->haswmh = 1;
+			wp->wmh.flags = v[0];
+			wp->wmh.input = v[1] != 0;
+			wp->wmh.initial_state = v[2];
+			wp->wmh.icon_pixmap = v[3];
+			wp->wmh.icon_window = v[4];
+			wp->wmh.icon_x = (int32_t)v[5];
+			wp->wmh.icon_y = (int32_t)v[6];
+			wp->wmh.icon_mask = v[7];
+			if (n >= 9)
+				wp->wmh.window_group = v[8];
+			else
+				wp->wmh.flags &= ~WindowGroupHint;
+		}
+
+		if (r[PropClientInfo] && r[PropClientInfo]->format == 32) {
+			v = xcb_get_property_value(r[PropClientInfo]);
+			for (i = 0; i < r[PropClientInfo]->value_len && i < LENGTH(wp->info); i++)
+				wp->info[i] = v[i];
+			wp->ninfo = i;
+		}
+		if (r[PropPid] && r[PropPid]->format == 32 && r[PropPid]->value_len)
+			wp->pid = *(uint32_t *)xcb_get_property_value(r[PropPid]);
+	}
+	free(attr);
+	free(geom);
+	for (i = 0; i < PropLast; i++)
+		free(r[i]);
+	return ok;
+}
+
+void
+focus(Client *c)
+{
+	if (!c || !ISVISIBLE(c))
+		for (c = selmon->stack; c && !ISVISIBLE(c); c = c->snext);
+	if (selmon->sel && selmon->sel != c)
+		unfocus(selmon->sel, 0);
+	journaldirty = 1;
+	if (c) {
+		if (c->mon != selmon)
 			selmon = c->mon;
 		if (c->isurgent)
 			seturgent(c, 0);
@@ -1069,6 +2035,43 @@ getatomprop(Client *c, Atom prop)
 	return atom;
 }
 
+/* parent of p from /proc, remembered for a while so walking up from every
+ * new window does not reread the same ancestors */
+pid_t
+getparentprocess(pid_t p)
+{
+	PidEntry *e, *lru = pidcache;
+	long now = nowms();
+	char buf[512], *s;
+	FILE *f;
+	int ppid = 0;
+
+	for (e = pidcache; e < pidcache + LENGTH(pidcache); e++) {
+		if (e->pid == p) {
+			if (now - e->fetched < PIDCACHETTL) {
+				e->used = ++pidclock;
+				return e->ppid;
+			}
+			lru = e;
+			break;
+		}
+		if (e->used < lru->used)
+			lru = e;
+	}
+	snprintf(buf, sizeof buf, "/proc/%u/stat", (unsigned int)p);
+	if (!(f = fopen(buf, "r")))
+		return 0;
+	/* the command name may hold spaces and parentheses of its own */
+	if (fgets(buf, sizeof buf, f) && (s = strrchr(buf, ')')))
+		sscanf(s + 1, " %*c %d", &ppid);
+	fclose(f);
+	lru->pid = p;
+	lru->ppid = ppid;
+	lru->fetched = now;
+	lru->used = ++pidclock;
+	return ppid;
+}
+
 int
 getrootptr(int *x, int *y)
 {
@@ -1079,29 +2082,9 @@ getrootptr(int *x, int *y)
 	return XQueryPointer(dpy, root, &dummy, &dummy, x, y, &di, &di, &dui);
 }
 
-long
-getstate(Window w)
-{
-	int format;
-	long result = -1;
-	unsigned char *p = NULL;
-	unsigned long n, extra;
-	Atom real;
-
-	if (XGetWindowProperty(dpy, w, wmatom[WMState], 0L, 2L, False, wmatom[WMState],
-		&real, &format, &n, &extra, (unsigned char **)&p) != Success)
-		return -1;
-	if (n != 0)
-		result = *p;
-	XFree(p);
-	return result;
-}
-
 int
 gettextprop(Window w, Atom atom, char *text, unsigned int size)
 {
-	char **list = NULL;
-	int n;
 	XTextProperty name;
 
 	if (!text || size == 0)
@@ -1109,13 +2092,7 @@ gettextprop(Window w, Atom atom, char *text, unsigned int size)
 	text[0] = '\0';
 	if (!XGetTextProperty(dpy, w, &name, atom) || !name.nitems)
 		return 0;
-	if (name.encoding == XA_STRING) {
-		strncpy(text, (char *)name.value, size - 1);
-	} else if (XmbTextPropertyToTextList(dpy, &name, &list, &n) >= Success && n > 0 && *list) {
-		strncpy(text, *list, size - 1);
-		XFreeStringList(list);
-	}
-	text[size - 1] = '\0';
+	decodetextprop(&name, text, size);
 	XFree(name.value);
 	return 1;
 }
@@ -1169,18 +2146,108 @@ grabkeys(void)
 	}
 }
 
+/* the grid keeps, per monitor and per column, how many clients live on
+ * each inner tag; rows grow on demand, every way onto a row goes through
+ * gridclamp() or a check against GRIDROWS, so columns stay below that */
+void
+gridadd(Client *c)
+{
+	unsigned int i, len;
+	Column *col;
+
+	for (i = 0; i < LENGTH(tags); i++) {
+		if (!(c->tags & 1 << i))
+			continue;
+		col = &c->mon->cols[i];
+		if (c->row >= col->len) {
+			for (len = MAX(col->len, 8); len <= c->row; len *= 2);
+			if (!(col->count = realloc(col->count, len * sizeof(unsigned int))))
+				die("realloc:");
+			memset(col->count + col->len, 0, (len - col->len) * sizeof(unsigned int));
+			col->len = len;
+		}
+		col->count[c->row]++;
+	}
+}
+
+/* rows from _NET_CLIENT_INFO, sessions, tagdown or viewdown may go at
+ * most one below the deepest inner tag in use in the columns of tagset */
+unsigned int
+gridclamp(Monitor *m, unsigned int tagset, unsigned int row)
+{
+	unsigned int i, r, limit = 0;
+
+	for (i = 0; i < LENGTH(tags); i++) {
+		if (!(tagset & 1 << i))
+			continue;
+		for (r = m->cols[i].len; r > limit && !m->cols[i].count[r - 1]; r--);
+		limit = MAX(limit, r);
+	}
+	return MIN(row, MIN(limit, GRIDROWS - 1));
+}
+
+void
+griddel(Client *c)
+{
+	unsigned int i;
+	Column *col;
+
+	for (i = 0; i < LENGTH(tags); i++) {
+		col = &c->mon->cols[i];
+		if (c->tags & 1 << i && c->row < col->len && col->count[c->row])
+			col->count[c->row]--;
+	}
+}
+
+/* inner tag a client tagged with tagset lands on: the one in view if it
+ * shares a column with the view, else the one its column last showed */
+unsigned int
+gridrow(Monitor *m, unsigned int tagset)
+{
+	unsigned int i;
+
+	if (tagset & m->tagset[m->seltags])
+		return m->row[m->seltags];
+	for (i = 0; i < LENGTH(tags); i++)
+		if (tagset & 1 << i)
+			return m->cols[i].row;
+	return 0;
+}
+
 int
 handlexevent(struct epoll_event *ev)
 {
 	if (ev->events & EPOLLIN) {
 		XEvent ev;
-		while (running && XPending(dpy)) {
-			XNextEvent(dpy, &ev);
-			if (handler[ev.type]) {
-				handler[ev.type](&ev); /* call handler */
+		/* MapRequests only queue their window, manage them all at once
+		 * once the backlog is drained; waiting for the replies may read
+		 * more events, so drain again afterwards */
+		do {
+			while (running && XPending(dpy)) {
+				XNextEvent(dpy, &ev);
+#ifdef XRANDR
+				/* a hotplug comes as a burst of these */
+				if (rrbase != -1 && (ev.type == rrbase + RRScreenChangeNotify
+				|| ev.type == rrbase + RRNotify)) {
+					XRRUpdateConfiguration(&ev);
+					monsdirty = 1;
+					continue;
+				}
+#endif /* XRANDR */
+				if (handler[ev.type]) {
+					handler[ev.type](&ev); /* call handler */
+					ipc_send_events(mons, &lastselmon, selmon);
+				}
+			}
+			if (monsdirty) {
+				updatemons();
 				ipc_send_events(mons, &lastselmon, selmon);
 			}
-		}
+			if (npending) {
+				manageflush();
+				ipc_send_events(mons, &lastselmon, selmon);
+			}
+		} while (running && XPending(dpy));
 	} else if (ev-> events & EPOLLHUP) {
 		return -1;
 	}
@@ -1188,6 +2255,29 @@ handlexevent(struct epoll_event *ev)
 	return 0;
 }
 
+/* where a client hidden from the view cell (tagset, row) is parked: below
+ * (or above) the monitor when it shares the view's column on a later (or
+ * earlier) inner tag, past the right (or left) edge when its column comes
+ * after (or before) the view's */
+void
+hidepos(Client *c, unsigned int tagset, unsigned int row, int *x, int *y)
+{
+	int i, ctag = 0, stag = 0;
+
+	for (i = 0; i < LENGTH(tags) && !ctag; i++)
+		if (c->tags & 1 << i)
+			ctag = i + 1;
+	for (i = 0; i < LENGTH(tags) && !stag; i++)
+		if (tagset & 1 << i)
+			stag = i + 1;
+	*x = c->x;
+	*y = c->y;
+	if (c->tags & tagset)
+		*y = (c->row > row ? c->mon->mh : -c->mon->mh) + c->y - c->mon->my;
+	else
+		*x = (ctag > stag ? c->mon->mw : -c->mon->mw) + c->x - c->mon->mx;
+}
+
 void
 incnmaster(const Arg *arg)
 {
@@ -1195,6 +2285,22 @@ incnmaster(const Arg *arg)
 	arrange(selmon);
 }
 
+/* class and instance names repeat a lot, keep one copy of each */
+const char *
+intern(const char *s)
+{
+	Interned **b = &interned[strhash(s) & (LENGTH(interned) - 1)], *i;
+
+	for (i = *b; i; i = i->next)
+		if (!strcmp(i->s, s))
+			return i->s;
+	i = ecalloc(1, sizeof(Interned) + strlen(s) + 1);
+	strcpy(i->s, s);
+	i->next = *b;
+	*b = i;
+	return i->s;
+}
+
 #ifdef XINERAMA
 static int
 isuniquegeom(XineramaScreenInfo *unique, size_t n, XineramaScreenInfo *info)
@@ -1207,6 +2313,175 @@ isuniquegeom(XineramaScreenInfo *unique, size_t n, XineramaScreenInfo *info)
 }
 #endif /* XINERAMA */
 
+/* journalpath in $XDG_RUNTIME_DIR, or ~/.cache without one, suffixed
+ * with the display so that each server gets a journal of its own */
+int
+journalfile(char *path, size_t len)
+{
+	const char *dir = getenv("XDG_RUNTIME_DIR"), *home = getenv("HOME");
+	char *p;
+	int n;
+
+	if (!journalpath)
+		return 0;
+	if (dir && *dir)
+		n = snprintf(path, len, "%s/", dir);
+	else if (home && *home) {
+		n = snprintf(path, len, "%s/.cache", home);
+		if (n > 0 && (size_t)n < len)
+			mkdir(path, 0700);
+		n = snprintf(path, len, "%s/.cache/", home);
+	} else
+		return 0;
+	if (n < 0 || (size_t)n >= len)
+		return 0;
+	if ((size_t)snprintf(path + n, len - n, "%s-%s", journalpath, DisplayString(dpy)) >= len - n)
+		return 0;
+	for (p = path + n; *p; p++)
+		if (*p == '/')
+			*p = '_';
+	return 1;
+}
+
+/* brings the journal in line with what changed since the last wakeup;
+ * records that still match are not touched, so their pages stay clean
+ * and moving one window rewrites little more than its own record */
+void
+journalflush(void)
+{
+	JournalClient jc;
+	SnapHeader h;
+	SnapMon sm;
+	SnapSup ss;
+	Monitor *m;
+	Client *c, *p;
+	unsigned int i, n = 0, nm = 0;
+
+	if (!journal || !journaldirty)
+		return;
+	journaldirty = 0;
+	for (i = 0; i < nsupervised && i < JOURNALSUP; i++) {
+		snapsup(&supervised[i], &ss);
+		journalput(&journal->sup[i], &ss, sizeof ss);
+	}
+	for (m = mons; m && nm < JOURNALMONS; m = m->next, nm++) {
+		snapmon(m, &sm);
+		sm.nclients = 0;
+		for (c = m->clients; c; c = c->next)
+			for (p = c; p && n < JOURNALCLIENTS; p = p == c ? c->info->swallowing : NULL) {
+				snapclient(p, c, &jc.c);
+				strncpy(jc.class, p->info->class, sizeof jc.class - 1);
+				strncpy(jc.instance, p->info->instance, sizeof jc.instance - 1);
+				jc.class[sizeof jc.class - 1] = jc.instance[sizeof jc.instance - 1] = '\0';
+				journalput(&journal->clients[n++], &jc, sizeof jc);
+				sm.nclients++;
+			}
+		journalput(&journal->mons[nm], &sm, sizeof sm);
+	}
+	snapheader(&h);
+	h.nmons = nm;
+	h.nsup = MIN(nsupervised, JOURNALSUP);
+	journalput(&journal->h, &h, sizeof h);
+	journalput(&journal->nclients, &n, sizeof n);
+	if (journal->clean)
+		journal->clean = 0;
+}
+
+/* maps the journal; unless self_restart() handed over a snapshot, what an
+ * unclean exit left in it is turned into one for scan() to restore */
+void
+journalload(void)
+{
+	Journal *j;
+	SnapHeader h;
+	char server[sizeof j->server] = "", boot[40] = "", path[512], *p;
+	size_t len, l;
+	unsigned int i, k, n;
+	int fd, stale, fmt;
+	unsigned long nitems, after, serverid = 0;
+	unsigned char *prop = NULL;
+	Atom idatom, type;
+	FILE *f;
+
+	if (!journalfile(path, sizeof path)
+	|| (fd = open(path, O_RDWR|O_CREAT|O_CLOEXEC|O_NOFOLLOW, 0600)) == -1)
+		return;
+	if (ftruncate(fd, sizeof(Journal)) == -1
+	|| (j = mmap(NULL, sizeof(Journal), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		close(fd);
+		return;
+	}
+	close(fd);
+	journal = j;
+	journaldirty = 1;
+	/* windows of another X server or boot must not be taken for ours; the
+	 * root property outlives dwm but not the server that holds it */
+	idatom = XInternAtom(dpy, "_DWM_SERVER_ID", False);
+	if (XGetWindowProperty(dpy, DefaultRootWindow(dpy), idatom, 0L, 1L, False, XA_CARDINAL,
+		&type, &fmt, &nitems, &after, &prop) == Success && prop) {
+		if (type == XA_CARDINAL && fmt == 32 && nitems == 1)
+			serverid = *(unsigned long *)prop;
+		XFree(prop);
+	}
+	if (!serverid) {
+		serverid = (((unsigned long)time(NULL) << 16 ^ getpid()) & 0xffffffff) | 1;
+		XChangeProperty(dpy, DefaultRootWindow(dpy), idatom, XA_CARDINAL, 32,
+			PropModeReplace, (unsigned char *)&serverid, 1);
+	}
+	if ((f = fopen("/proc/sys/kernel/random/boot_id", "r"))) {
+		if (fgets(boot, sizeof boot, f))
+			boot[strcspn(boot, "\n")] = '\0';
+		fclose(f);
+	}
+	snprintf(server, sizeof server, "%s %s %d %lx %s", DisplayString(dpy),
+		ServerVendor(dpy), VendorRelease(dpy), serverid, boot);
+	stale = snapbuf || j->clean || strncmp(j->server, server, sizeof server)
+	|| memcmp(j->h.magic, SNAPMAGIC, sizeof j->h.magic)
+	|| j->h.monsize != sizeof(SnapMon) || j->h.clientsize != sizeof(SnapClient)
+	|| j->h.nmons > JOURNALMONS || j->h.nsup > JOURNALSUP || j->nclients > JOURNALCLIENTS;
+	/* consumed: a restore that crashes is not tried again */
+	j->clean = 1;
+	journalput(j->server, server, sizeof server);
+	if (stale)
+		return;
+	len = sizeof h + j->h.nsup * sizeof(SnapSup) + j->h.nmons * sizeof(SnapMon);
+	for (i = 0; i < j->nclients; i++)
+		len += sizeof(SnapClient) + 1
+			+ strnlen(j->clients[i].class, sizeof j->clients[i].class - 1) + 1
+			+ strnlen(j->clients[i].instance, sizeof j->clients[i].instance - 1) + 1;
+	p = snapbuf = ecalloc(1, len);
+	h = j->h;
+	h.ipcoff = 0;
+	memcpy(p, &h, sizeof h);
+	p += sizeof h;
+	memcpy(p, j->sup, h.nsup * sizeof(SnapSup));
+	p += h.nsup * sizeof(SnapSup);
+	for (i = k = 0; i < h.nmons; i++) {
+		memcpy(p, &j->mons[i], sizeof(SnapMon));
+		p += sizeof(SnapMon);
+		for (n = 0; n < j->mons[i].nclients && k < j->nclients; n++, k++) {
+			memcpy(p, &j->clients[k].c, sizeof(SnapClient));
+			p += sizeof(SnapClient);
+			*p++ = '\0';
+			l = strnlen(j->clients[k].class, sizeof j->clients[k].class - 1);
+			memcpy(p, j->clients[k].class, l);
+			p += l + 1;
+			l = strnlen(j->clients[k].instance, sizeof j->clients[k].instance - 1);
+			memcpy(p, j->clients[k].instance, l);
+			p += l + 1;
+		}
+	}
+	snapbuflen = p - snapbuf;
+	fprintf(stderr, "dwm: recovering %u clients from %s\n", j->nclients, path);
+}
+
+void
+journalput(void *dst, const void *src, size_t len)
+{
+	if (memcmp(dst, src, len))
+		memcpy(dst, src, len);
+}
+
 void
 keypress(XEvent *e)
 {
@@ -1239,34 +2514,119 @@ killclient(const Arg *arg)
 	}
 }
 
+/* close every client on the cell shown for arg->ui, or on the view when 0;
+ * their WM_PROTOCOLS are asked for in one burst, and clients that ignore
+ * WM_DELETE_WINDOW are killed under a single grab */
 void
-manage(Window w, XWindowAttributes *wa)
+killtag(const Arg *arg)
+{
+	unsigned int tagset, row, i, k, n = 0;
+	int grabbed = 0, del;
+	xcb_get_property_cookie_t *pc;
+	xcb_get_property_reply_t *r;
+	xcb_atom_t *a;
+	Client *c, **cs;
+
+	tagset = arg->ui & TAGMASK ? arg->ui & TAGMASK : selmon->tagset[selmon->seltags];
+	row = gridrow(selmon, tagset);
+	for (c = selmon->clients; c; c = c->next)
+		n += (c->tags & tagset) && c->row == row;
+	if (!n)
+		return;
+	cs = ecalloc(n, sizeof(Client *));
+	pc = ecalloc(n, sizeof(*pc));
+	for (i = 0, c = selmon->clients; c; c = c->next)
+		if ((c->tags & tagset) && c->row == row) {
+			cs[i] = c;
+			pc[i++] = xcb_get_property(xcon, 0, c->win, wmatom[WMProtocols], XA_ATOM, 0, 32);
+		}
+	for (i = 0; i < n; i++) {
+		del = 0;
+		if ((r = xcb_get_property_reply(xcon, pc[i], NULL))) {
+			a = xcb_get_property_value(r);
+			for (k = r->format == 32 ? r->value_len : 0; !del && k--;)
+				del = a[k] == wmatom[WMDelete];
+			free(r);
+		}
+		if (del) {
+			sendprotocol(cs[i], wmatom[WMDelete]);
+			continue;
+		}
+		if (!grabbed) {
+			XGrabServer(dpy);
+			XSetErrorHandler(xerrordummy);
+			XSetCloseDownMode(dpy, DestroyAll);
+			grabbed = 1;
+		}
+		XKillClient(dpy, cs[i]->win);
+	}
+	if (grabbed) {
+		XSync(dpy, False);
+		XSetErrorHandler(xerror);
+		XUngrabServer(dpy);
+	}
+	free(cs);
+	free(pc);
+}
+
+/* milliseconds since *t, which is then moved to now */
+double
+lap(struct timespec *t)
+{
+	struct timespec now;
+	double ms;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ms = (now.tv_sec - t->tv_sec) * 1e3 + (now.tv_nsec - t->tv_nsec) / 1e6;
+	*t = now;
+	return ms;
+}
+
+/* sets up a client from the properties fetchprops() collected; mapping
+ * it, arranging and focusing are left to manageflush() */
+Client *
+manage(WinProps *wp)
 {
     Client *c, *t = NULL;
-    Window trans = None;
+    Window w = wp->win;
     XWindowChanges wc;
-    c = ecalloc(1, sizeof(Client));
+    int i;
+    c = clientalloc();
     c->win = w;
     /* geometry */
-    c->x = c->oldx = wa->x;
-    c->y = c->oldy = wa->y;
-    c->w = c->oldw = wa->width;
-    c->h = c->oldh = wa->height;
-    c->oldbw = wa->border_width;
-    updatetitle(c);
-    if (XGetTransientForHint(dpy, w, &trans) && (t = wintoclient(trans))) {
+    c->x = c->oldx = wp->wa.x;
+    c->y = c->oldy = wp->wa.y;
+    c->w = c->oldw = wp->wa.width;
+    c->h = c->oldh = wp->wa.height;
+    c->oldbw = wp->wa.border_width;
+    c->info->name = estrdup(wp->name);
+    c->info->namefetched = nowms();
+    c->info->class = intern(wp->class);
+    c->info->instance = intern(wp->instance);
+    c->info->pid = wp->pid;
+    if (wp->trans != None && (t = wintoclient(wp->trans))) {
         c->mon = t->mon;
         c->tags = t->tags;
+        c->row = t->row;
+    } else if (applysession(c, wp->pid)) {
+        /* placed as the loaded session had it */
     } else {
         c->mon = selmon;
-        applyrules(c);
+        applyrules(c, wp->class, wp->instance);
+        /* warm pool instances wait on their hidden tag */
+        if ((i = poolmatch(wp->pid))) {
+            c->tags = POOLTAG(i - 1);
+            c->row = 0;
+        }
     }
 
     /* Check if window should be floating and apply remembered size */
     if (!c->isfloating)
-        c->isfloating = c->oldstate = trans != None || c->isfixed;
+        c->isfloating = c->oldstate = wp->trans != None || c->isfixed;
 
-    if (c->isfloating && remembered_width > 0 && remembered_height > 0) {
+    if (c->info->sessionpos) {
+        /* keep the saved geometry of a session window */
+    } else if (c->isfloating && remembered_width > 0 && remembered_height > 0) {
         c->w = remembered_width;
         c->h = remembered_height;
         /* Center the window with remembered dimensions */
@@ -1287,26 +2647,20 @@ manage(Window w, XWindowAttributes *wa)
     XConfigureWindow(dpy, w, CWBorderWidth, &wc);
     XSetWindowBorder(dpy, w, scheme[SchemeNorm][ColBorder].pixel);
     configure(c); /* propagates border_width, if size doesn't change */
-    updatewindowtype(c);
-    updatesizehints(c);
-    updatewmhints(c);
-    {
-        int format;
-        unsigned long *data, n, extra;
+    setwindowtype(c, wp->state, wp->wtype);
+    setsizehints(c, &wp->size);
+    if (wp->haswmh)
+        setwmhints(c, &wp->wmh);
+    if (wp->ninfo >= 2) {
         Monitor *m;
-        Atom atom;
-        if (XGetWindowProperty(dpy, c->win, netatom[NetClientInfo], 0L, 2L, False, XA_CARDINAL,
-                               &atom, &format, &n, &extra, (unsigned char **)&data) == Success && n == 2) {
-            c->tags = *data;
-            for (m = mons; m; m = m->next) {
-                if (m->num == *(data+1)) {
-                    c->mon = m;
-                    break;
-                }
+        c->tags = wp->info[0];
+        for (m = mons; m; m = m->next) {
+            if (m->num == wp->info[1]) {
+                c->mon = m;
+                break;
             }
         }
-        if (n > 0)
-            XFree(data);
+        c->row = wp->ninfo > 2 ? gridclamp(c->mon, c->tags, wp->info[2]) : 0;
     }
     setclienttagprop(c);
     XSelectInput(dpy, w, EnterWindowMask|FocusChangeMask|PropertyChangeMask|StructureNotifyMask);
@@ -1314,20 +2668,23 @@ manage(Window w, XWindowAttributes *wa)
     
     if (c->isfloating)
         XRaiseWindow(dpy, c->win);
-    attach(c);
+    if (c->info->sessionpos)
+        attachsession(c);
+    else
+        attach(c);
     attachstack(c);
-    XChangeProperty(dpy, root, netatom[NetClientList], XA_WINDOW, 32, PropModeAppend,
-                    (unsigned char *) &(c->win), 1);
+    gridadd(c);
+    clientlistadd(c->win);
     XMoveResizeWindow(dpy, c->win, c->x + 2 * sw, c->y, c->w, c->h); /* some windows require this */
+    c->ax = c->x + 2 * sw;
+    c->ay = c->y;
+    c->aw = c->w;
+    c->ah = c->h;
     setclientstate(c, NormalState);
     if (c->mon == selmon)
         unfocus(selmon->sel, 0);
     c->mon->sel = c;
-    arrange(c->mon);
-    XMapWindow(dpy, c->win);
-    if (c && c->mon == selmon)
-        XWarpPointer(dpy, None, c->win, 0, 0, 0, 0, c->w/2, c->h/2);
-    focus(NULL);
+    return c;
 }
 
 void
@@ -1342,11 +2699,96 @@ managealtbar(Window win, XWindowAttributes *wa)
 	bh = m->bh = wa->height;
 	updatebarpos(m);
 	arrange(m);
-	XSelectInput(dpy, win, EnterWindowMask|FocusChangeMask|PropertyChangeMask|StructureNotifyMask);
+	/* it covers the top edge strip, motionnotify() stands in for it */
+	XSelectInput(dpy, win, EnterWindowMask|FocusChangeMask|PointerMotionMask|PropertyChangeMask|StructureNotifyMask);
 	XMoveResizeWindow(dpy, win, wa->x, wa->y, wa->width, wa->height);
 	XMapWindow(dpy, win);
-	XChangeProperty(dpy, root, netatom[NetClientList], XA_WINDOW, 32, PropModeAppend,
-		(unsigned char *) &win, 1);
+	clientlistadd(win);
+}
+
+/* manages every window queued since the last call: the replies to all of
+ * their property requests are collected in one go, then each monitor that
+ * got new clients is arranged once and focus is updated once */
+void
+manageflush(void)
+{
+	unsigned int i, n, touched = 0;
+	Client *c, *t, *warp = NULL;
+	Monitor *m;
+	WinProps wp;
+	struct timespec now;
+
+	if (!(n = npending))
+		return;
+	npending = 0;
+	for (i = 0; i < n; i++) {
+		pending[i].c = NULL;
+		if (!fetchprops(&pending[i], &wp))
+			continue;
+		if (wp.hasclass && strstr(wp.class, altbarclass))
+			managealtbar(wp.win, &wp.wa);
+		else if (!wintoclient(wp.win)) {
+			c = pending[i].c = manage(&wp);
+			if (wp.trans == None && (t = termforwin(c)))
+				swallow(t, c);
+			touched |= 1 << c->mon->num;
+		}
+	}
+	if (!touched)
+		return;
+	for (m = mons; m; m = m->next)
+		if (touched & 1 << m->num)
+			arrange(m);
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	for (i = 0; i < n; i++)
+		if ((c = pending[i].c)) {
+			XMapWindow(dpy, c->win);
+			launchrecord(c, &pending[i].requested, &now);
+			if (c->mon == selmon && ISVISIBLE(c))
+				warp = c;
+		}
+	if (warp)
+		XWarpPointer(dpy, None, warp->win, 0, 0, 0, 0, warp->w/2, warp->h/2);
+	focus(NULL);
+}
+
+/* queues w for manageflush() and sends all the requests manage() needs
+ * without waiting for any reply */
+void
+managerequest(Window w)
+{
+	Pending *p;
+	unsigned int i;
+	static const struct { int prop; Atom *atom; Atom name; Atom type; uint32_t len; } props[] = {
+		{ PropNetWMName,       &netatom[NetWMName],       0,                   XCB_GET_PROPERTY_TYPE_ANY, 256 },
+		{ PropWMName,          NULL,                      XA_WM_NAME,          XCB_GET_PROPERTY_TYPE_ANY, 256 },
+		{ PropTransientFor,    NULL,                      XA_WM_TRANSIENT_FOR, XA_WINDOW,                 1 },
+		{ PropClass,           NULL,                      XA_WM_CLASS,         XA_STRING,                 128 },
+		{ PropNetWMState,      &netatom[NetWMState],      0,                   XA_ATOM,                   1 },
+		{ PropNetWMWindowType, &netatom[NetWMWindowType], 0,                   XA_ATOM,                   1 },
+		{ PropNormalHints,     NULL,                      XA_WM_NORMAL_HINTS,  XA_WM_SIZE_HINTS,          18 },
+		{ PropHints,           NULL,                      XA_WM_HINTS,         XA_WM_HINTS,               9 },
+		{ PropClientInfo,      &netatom[NetClientInfo],   0,                   XA_CARDINAL,               3 },
+		{ PropPid,             &netatom[NetWMPid],        0,                   XA_CARDINAL,               1 },
+	};
+
+	for (i = 0; i < npending; i++)
+		if (pending[i].win == w && !pending[i].dead)
+			return;
+	if (npending == pendingcap) {
+		pendingcap = pendingcap ? pendingcap * 2 : 16;
+		if (!(pending = realloc(pending, pendingcap * sizeof(Pending))))
+			die("realloc:");
+	}
+	p = &pending[npending++];
+	p->win = w;
+	p->dead = 0;
+	clock_gettime(CLOCK_MONOTONIC, &p->requested);
+	p->attr = xcb_get_window_attributes(xcon, w);
+	p->geom = xcb_get_geometry(xcon, w);
+	for (i = 0; i < LENGTH(props); i++)
+		p->prop[props[i].prop] = xcb_get_property(xcon, 0, w,
+			props[i].atom ? *props[i].atom : props[i].name, props[i].type, 0, props[i].len);
 }
 
 void
@@ -1362,15 +2804,63 @@ mappingnotify(XEvent *e)
 void
 maprequest(XEvent *e)
 {
-	static XWindowAttributes wa;
 	XMapRequestEvent *ev = &e->xmaprequest;
 
-	if (!XGetWindowAttributes(dpy, ev->window, &wa) || wa.override_redirect)
-		return;
-	if (wmclasscontains(ev->window, altbarclass, ""))
-		managealtbar(ev->window, &wa);
-	else if (!wintoclient(ev->window))
-		manage(ev->window, &wa);
+	if (!wintoclient(ev->window))
+		managerequest(ev->window);
+}
+
+/* fills in what the rules matching c ask for; only the rules hashed under
+ * its exact class or instance and those with patterns are tried. Returns
+ * a key for the set of rules that matched, 0 if none did */
+unsigned int
+matchrules(Client *c, const char *class, const char *instance,
+		unsigned int *tags, int *isfloating, Monitor **mon)
+{
+	int cand[LENGTH(rules)], k, mnum = -1, nmons;
+	unsigned int i, j, n = 0, key = 0;
+	const Rule *r;
+	const RuleIndex *ri;
+	Monitor *m;
+
+	c->info->isterminal = c->info->noswallow = 0;
+	for (k = rulehead[0][strhash(class) & (rulebuckets - 1)]; k; k = ruleidx[k - 1].next)
+		cand[n++] = k - 1;
+	for (k = rulehead[1][strhash(instance) & (rulebuckets - 1)]; k; k = ruleidx[k - 1].next)
+		cand[n++] = k - 1;
+	for (i = 0; i < nrulepatterns; i++)
+		cand[n++] = rulepatterns[i];
+	/* rules apply in the order they are written */
+	for (i = 1; i < n; i++)
+		for (j = i; j > 0 && cand[j - 1] > cand[j]; j--) {
+			k = cand[j];
+			cand[j] = cand[j - 1];
+			cand[j - 1] = k;
+		}
+
+	for (nmons = 0, m = mons; m; m = m->next, nmons++);
+	for (i = 0; i < n; i++) {
+		r = &rules[cand[i]];
+		ri = &ruleidx[cand[i]];
+		if (patternmatch(&ri->class, class)
+		&& patternmatch(&ri->instance, instance)
+		&& patternmatch(&ri->title, clientname(c)))
+		{
+			key = key * 31 + cand[i] + 1;
+			*isfloating = r->isfloating;
+			*tags |= r->tags;
+			c->info->isterminal = r->isterminal;
+			c->info->noswallow = r->noswallow;
+			if (r->monitor >= 0 && r->monitor < nmons)
+				mnum = r->monitor;
+		}
+	}
+	if (mnum >= 0) {
+		for (m = mons; m && m->num != mnum; m = m->next);
+		if (m)
+			*mon = m;
+	}
+	return key;
 }
 
 void
@@ -1391,18 +2881,15 @@ monocle(Monitor *m)
 void
 motionnotify(XEvent *e)
 {
-	static Monitor *mon = NULL;
 	Monitor *m;
 	XMotionEvent *ev = &e->xmotion;
 
-	if (ev->window != root)
-		return;
-	if ((m = recttomon(ev->x_root, ev->y_root, 1, 1)) != mon && mon) {
-		unfocus(selmon->sel, 1);
-		selmon = m;
-		focus(NULL);
-	}
-	mon = m;
+	/* only the bars still ask for motion, ours or an external one, they
+	 * cover the top edge strip; monitor changes arrive as crossings, see
+	 * updateedges() */
+	for (m = mons; m && m->barwin != ev->window; m = m->next);
+	if (m)
+		checkedgeswitch(ev->x_root, ev->y_root);
 }
 
 void
@@ -1458,6 +2945,23 @@ movemouse(const Arg *arg)
 	}
 }
 
+#if defined(XRANDR) || defined(XINERAMA)
+/* moves c to m keeping its tags, for monitors that come and go */
+void
+movetomon(Client *c, Monitor *m)
+{
+	detach(c);
+	detachstack(c);
+	griddel(c);
+	c->mon = m;
+	if (c->info->swallowing)
+		c->info->swallowing->mon = m;
+	gridadd(c);
+	attach(c);
+	attachstack(c);
+}
+#endif /* XRANDR || XINERAMA */
+
 unsigned int
 nexttag(void)
 {
@@ -1488,6 +2992,123 @@ nexttiled(Client *c)
 	return c;
 }
 
+/* the first window of a process we started, or of one of its children,
+ * ends that launch: keep how long it took to ask for a map and to be up */
+void
+launchrecord(Client *c, const struct timespec *requested, const struct timespec *shown)
+{
+	Child *ch = NULL;
+	Launch *l;
+	pid_t pid = c->info->pid;
+	unsigned int i, depth;
+
+	for (depth = 0; pid > 1 && !ch && depth < 4; depth++) {
+		for (i = 0; i < nchildren && !ch; i++)
+			if (children[i].pid == pid && children[i].cmd && !children[i].launched)
+				ch = &children[i];
+		pid = getparentprocess(pid);
+	}
+	if (!ch)
+		return;
+	ch->launched = 1;
+	for (i = 0; i < nlaunches && launches[i].cmd != ch->cmd; i++);
+	if (i == nlaunches) {
+		if (!(launches = realloc(launches, ++nlaunches * sizeof(Launch))))
+			die("realloc:");
+		memset(&launches[i], 0, sizeof(Launch));
+		launches[i].cmd = ch->cmd;
+	}
+	l = &launches[i];
+	i = l->n++ % LAUNCHSAMPLES;
+	l->map[i] = (requested->tv_sec - ch->started.tv_sec) * 1e3
+		+ (requested->tv_nsec - ch->started.tv_nsec) / 1e6;
+	l->shown[i] = (shown->tv_sec - ch->started.tv_sec) * 1e3
+		+ (shown->tv_nsec - ch->started.tv_nsec) / 1e6;
+}
+
+long
+nowms(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+int
+patternmatch(const Pattern *p, const char *s)
+{
+	switch (p->type) {
+	case MatchExact: return !strcmp(p->str, s);
+	case MatchGlob:  return !fnmatch(p->str, s, 0);
+	case MatchRegex: return !regexec(&p->re, s, 0, NULL, 0);
+	}
+	return 1;
+}
+
+int
+pidfdopen(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+	return syscall(SYS_pidfd_open, pid, 0);
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+/* starts instances until each pool has its n waiting or on their way */
+void
+poolfill(void)
+{
+	unsigned int i, j, n;
+	long now = nowms();
+	Client *c;
+	Monitor *m;
+	pid_t pid;
+
+	for (i = 0; i < npoolstarting; i++)
+		if (now - poolstarting[i].started > POOLTIMEOUT)
+			poolstarting[i--] = poolstarting[--npoolstarting];
+	for (i = 0; i < LENGTH(pools); i++) {
+		for (n = 0, m = mons; m; m = m->next)
+			for (c = m->clients; c; c = c->next)
+				n += !!(c->tags & POOLTAG(i));
+		for (j = 0; j < npoolstarting; j++)
+			n += poolstarting[j].pool == i;
+		for (; n < pools[i].n && npoolstarting < LENGTH(poolstarting); n++) {
+			if ((pid = spawnpid(pools[i].cmd)) <= 0)
+				break;
+			/* warm starts are not launches anyone waits for */
+			for (j = 0; j < nchildren && children[j].pid != pid; j++);
+			if (j < nchildren)
+				children[j].launched = 1;
+			poolstarting[npoolstarting].pid = pid;
+			poolstarting[npoolstarting].pool = i;
+			poolstarting[npoolstarting++].started = now;
+		}
+	}
+}
+
+/* 1 + the pool a new window with _NET_WM_PID pid was started for, or 0;
+ * the command may have gone through a shell or two */
+int
+poolmatch(pid_t pid)
+{
+	unsigned int i, depth;
+
+	for (depth = 0; pid > 1 && npoolstarting && depth < 4; depth++) {
+		for (i = 0; i < npoolstarting; i++)
+			if (poolstarting[i].pid == pid) {
+				pid = poolstarting[i].pool;
+				poolstarting[i] = poolstarting[--npoolstarting];
+				return pid + 1;
+			}
+		pid = getparentprocess(pid);
+	}
+	return 0;
+}
+
 void
 pop(Client *c)
 {
@@ -1519,6 +3140,28 @@ prevtag(void)
 	return seltag;
 }
 
+/* the monitor holding the point, or NULL; pointer motion mostly stays
+ * within the monitor found last, so that one is tried first */
+Monitor *
+pointtomon(int x, int y)
+{
+	unsigned int lo, hi, mid;
+
+	if (ptrmon && INMON(x, y, ptrmon))
+		return ptrmon;
+	for (lo = 0, hi = nmonindex; lo < hi;) {
+		mid = (lo + hi) / 2;
+		if (monindex[mid]->mx <= x)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	while (lo-- > 0)
+		if (INMON(x, y, monindex[lo]))
+			return ptrmon = monindex[lo];
+	return NULL;
+}
+
 void
 propertynotify(XEvent *e)
 {
@@ -1539,18 +3182,25 @@ propertynotify(XEvent *e)
 				arrange(c->mon);
 			break;
 		case XA_WM_NORMAL_HINTS:
-			c->hintsvalid = 0;
+			c->info->hintsvalid = 0;
 			break;
 		case XA_WM_HINTS:
+			/* our own urgency writes come back here, the cache
+			 * already holds what we wrote */
+			if (c->info->wmhsent && ev->state == PropertyNewValue) {
+				c->info->wmhsent--;
+				break;
+			}
 			updatewmhints(c);
 			drawbars();
 			break;
+		case XA_WM_CLASS:
+			updateclass(c);
+			updaterules(c);
+			break;
 		}
-		if (ev->atom == XA_WM_NAME || ev->atom == netatom[NetWMName]) {
-			updatetitle(c);
-			if (c == c->mon->sel)
-				drawbar(c->mon);
-		}
+		if (ev->atom == XA_WM_NAME || ev->atom == netatom[NetWMName])
+			titledirty(c);
 		if (ev->atom == netatom[NetWMWindowType])
 			updatewindowtype(c);
 	}
@@ -1559,25 +3209,96 @@ propertynotify(XEvent *e)
 void
 quit(const Arg *arg)
 {
-	size_t i;
-
-	/* kill child processes */
-	for (i = 0; i < autostart_len; i++) {
-		if (0 < autostart_pids[i]) {
-			kill(autostart_pids[i], SIGTERM);
-			waitpid(autostart_pids[i], NULL, 0);
-		}
+	unsigned int i, left = 1;
+	long until = nowms() + SUPQUITWAIT;
+	struct timespec ts = { 0, 10000000 };
+
+	/* kill supervised processes */
+	for (i = 0; i < nsupervised; i++) {
+		if (supervised[i].pid > 0)
+			kill(supervised[i].pid, SIGTERM);
+		supervised[i].state = SupStopped;
 	}
+	/* reap them for a while, one that ignores SIGTERM is left behind */
+	while (left && nowms() < until) {
+		for (i = left = 0; i < nsupervised; i++)
+			if (supervised[i].pid > 0 && waitpid(supervised[i].pid, NULL, WNOHANG) == 0)
+				left = 1;
+			else
+				supervised[i].pid = 0;
+		if (left)
+			nanosleep(&ts, NULL);
+	}
+	for (i = 0; i < nsupervised; i++)
+		supervised[i].pid = 0;
 
 	running = 0;
 }
 
+/* a child exited: collect its status and forget it */
+void
+reapchild(Child *ch)
+{
+	pid_t pid = ch->pid;
+	int status;
+	unsigned int i;
+
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, ch->pidfd, NULL);
+	close(ch->pidfd);
+	*ch = children[--nchildren];
+	if (waitpid(pid, &status, WNOHANG) != pid)
+		status = -1; /* someone else reaped it */
+	DEBUG("child %d exited with status %d\n", (int)pid, status);
+	supervisereap(pid, status);
+	/* a pool instance that died before mapping can be replaced */
+	for (i = 0; i < npoolstarting; i++)
+		if (poolstarting[i].pid == pid)
+			poolstarting[i--] = poolstarting[--npoolstarting];
+}
+
+/* send every client a rule matches back to where the rule puts it; the
+ * clients move in memory and each monitor they touch is arranged once */
+void
+reapplyrules(const Arg *arg)
+{
+	Client *c, *next;
+	Monitor *m, *mon;
+	unsigned int newtags, touched = 0;
+	int isfloating;
+
+	for (m = mons; m; m = m->next)
+		for (c = m->clients; c; c = next) {
+			next = c->next;
+			newtags = 0;
+			isfloating = 0;
+			mon = c->mon;
+			if (!(c->info->rulekey = matchrules(c, c->info->class, c->info->instance, &newtags, &isfloating, &mon)))
+				continue;
+			if (!(newtags &= TAGMASK))
+				newtags = c->tags;
+			if (newtags == c->tags && mon == c->mon && (!isfloating || c->isfloating))
+				continue;
+			touched |= 1 << c->mon->num | 1 << mon->num;
+			if (isfloating)
+				c->isfloating = 1;
+			retag(c, mon, newtags);
+		}
+	if (!touched)
+		return;
+	for (m = mons; m; m = m->next)
+		if (touched & 1 << m->num)
+			arrange(m);
+	focus(NULL);
+}
+
 Monitor *
 recttomon(int x, int y, int w, int h)
 {
 	Monitor *m, *r = selmon;
 	int a, area = 0;
 
+	if (w == 1 && h == 1 && (m = pointtomon(x, y)))
+		return m;
 	for (m = mons; m; m = m->next)
 		if ((a = INTERSECT(x, y, w, h, m)) > area) {
 			area = a;
@@ -1603,6 +3324,19 @@ resizeclient(Client *c, int x, int y, int w, int h)
 	c->oldw = c->w; c->w = wc.width = w;
 	c->oldh = c->h; c->h = wc.height = h;
 	wc.border_width = c->bw;
+	journaldirty = 1;
+	/* layout reflows and resizes during a slide are left to the frame
+	 * timer, which configures the client once it arrives */
+	if (ISVISIBLE(c) && (c->animframe || (animarrange && c->aw))) {
+		XConfigureWindow(dpy, c->win, CWBorderWidth, &wc);
+		animstart(c, c->ax, c->ay, x, y);
+		return;
+	}
+	c->animframe = 0;
+	c->ax = x;
+	c->ay = y;
+	c->aw = w;
+	c->ah = h;
 	XConfigureWindow(dpy, c->win, CWX|CWY|CWWidth|CWHeight|CWBorderWidth, &wc);
 	configure(c);
 	XSync(dpy, False);
@@ -1665,16 +3399,16 @@ resizemouse(const Arg *arg)
             lasttime = ev.xmotion.time;
 
             // Calculate new position and size based on which corner we're dragging
-            nx = horizcorner && ocx2 - ev.xmotion.x >= c->minw ? ev.xmotion.x : c->x;
-            ny = vertcorner && ocy2 - ev.xmotion.y >= c->minh ? ev.xmotion.y : c->y;
+            nx = horizcorner && ocx2 - ev.xmotion.x >= c->info->minw ? ev.xmotion.x : c->x;
+            ny = vertcorner && ocy2 - ev.xmotion.y >= c->info->minh ? ev.xmotion.y : c->y;
             nw = MAX(horizcorner ? (ocx2 - nx) : (ev.xmotion.x - ocx - 2 * c->bw + 1), 1);
             nh = MAX(vertcorner ? (ocy2 - ny) : (ev.xmotion.y - ocy - 2 * c->bw + 1), 1);
 
             // Handle minimum size constraints
             if (horizcorner && ev.xmotion.x > ocx2)
-                nx = ocx2 - (nw = c->minw);
+                nx = ocx2 - (nw = c->info->minw);
             if (vertcorner && ev.xmotion.y > ocy2)
-                ny = ocy2 - (nh = c->minh);
+                ny = ocy2 - (nh = c->info->minh);
 
             // Check if the new size is within monitor bounds
             if (c->mon->wx + nw >= selmon->wx && c->mon->wx + nw <= selmon->wx + selmon->ww
@@ -1716,6 +3450,7 @@ restack(Monitor *m)
     XEvent ev;
     XWindowChanges wc;
     drawbar(m);
+    stacklistdirty = journaldirty = 1;
     if (!m->sel)
         return;
     if (m->sel->isfloating || !m->lt[m->sellt]->arrange)
@@ -1733,6 +3468,25 @@ restack(Monitor *m)
     while (XCheckMaskEvent(dpy, EnterWindowMask, &ev));
 }
 
+/* move c to tags on m without arranging, so callers can batch */
+void
+retag(Client *c, Monitor *m, unsigned int tags)
+{
+	griddel(c);
+	if (c->tags != tags || c->mon != m)
+		c->row = gridrow(m, tags);
+	if (c->mon != m) {
+		detach(c);
+		detachstack(c);
+		c->mon = m;
+		attach(c);
+		attachstack(c);
+	}
+	c->tags = tags;
+	gridadd(c);
+	setclienttagprop(c);
+}
+
 void
 rotatestack(const Arg *arg)
 {
@@ -1765,19 +3519,124 @@ rotatestack(const Arg *arg)
 	}
 }
 
-// TODO checkedgeswitch() should not be here
-// instead use the mouse pos callback
+#ifdef XRANDR
+/* takes the first monitor in *list named output off it */
+static Monitor *
+monunlink(Monitor **list, Atom output)
+{
+	Monitor **mp, *m;
+
+	for (mp = list; *mp && (*mp)->output != output; mp = &(*mp)->next);
+	if (!(m = *mp))
+		return NULL;
+	*mp = m->next;
+	m->next = NULL;
+	return m;
+}
+#endif /* XRANDR */
+
+/* rebuilds mons from the RandR 1.5 monitors, matched by name so that a
+ * monitor keeps its tags, layout and clients over a hotplug; unplugged
+ * ones are parked with their clients waiting on the first monitor until
+ * they come back. Returns whether anything changed, -1 without RandR */
+int
+rrmonitors(void)
+{
+#ifdef XRANDR
+	XRRMonitorInfo *info;
+	Monitor *m, *t, *old, **tail;
+	Client *c, *next;
+	int i, n, dirty = 0;
+
+	if (rrbase == -1 || !(info = XRRGetMonitors(dpy, root, True, &n)))
+		return -1;
+	if (n <= 0) {
+		XRRFreeMonitors(info);
+		return -1;
+	}
+	old = mons;
+	mons = NULL;
+	for (i = 0, tail = &mons; i < n; i++, tail = &m->next) {
+		if (!(m = monunlink(&old, info[i].name))
+		&& !(m = monunlink(&parkedmons, info[i].name))
+		&& !(m = monunlink(&old, None)))
+			m = createmon();
+		m->output = info[i].name;
+		*tail = m;
+		if (m->num != i || m->mx != info[i].x || m->my != info[i].y
+		|| m->mw != info[i].width || m->mh != info[i].height) {
+			m->num = i;
+			m->mx = m->wx = info[i].x;
+			m->my = m->wy = info[i].y;
+			m->mw = m->ww = info[i].width;
+			m->mh = m->wh = info[i].height;
+			updatebarpos(m);
+			m->geomdirty = dirty = 1;
+		}
+	}
+	XRRFreeMonitors(info);
+	while ((m = old)) {
+		old = m->next;
+		while ((c = m->clients)) {
+			c->info->homeoutput = m->output;
+			movetomon(c, mons);
+		}
+		if (m == selmon)
+			selmon = mons;
+		if (m->barwin && !usealtbar) {
+			XUnmapWindow(dpy, m->barwin);
+			XDestroyWindow(dpy, m->barwin);
+		}
+		m->barwin = 0;
+		for (i = 0; i < (int)LENGTH(m->edgewin); i++)
+			if (m->edgewin[i])
+				XDestroyWindow(dpy, m->edgewin[i]);
+		memset(m->edgewin, 0, sizeof m->edgewin);
+		m->sel = m->lastsel = NULL;
+		m->next = parkedmons;
+		parkedmons = m;
+		mons->geomdirty = dirty = 1;
+	}
+	/* clients whose monitor is back return to it */
+	for (m = mons; m; m = m->next)
+		for (c = m->clients; c; c = next) {
+			next = c->next;
+			if (!c->info->homeoutput)
+				continue;
+			for (t = mons; t && t->output != c->info->homeoutput; t = t->next);
+			if (!t)
+				continue;
+			c->info->homeoutput = None;
+			if (t == m)
+				continue;
+			movetomon(c, t);
+			m->geomdirty = t->geomdirty = dirty = 1;
+		}
+	return dirty;
+#else
+	return -1;
+#endif /* XRANDR */
+}
+
 void
 run(void)
 {
     int event_count = 0;
     const int MAX_EVENTS = 10;
     struct epoll_event events[MAX_EVENTS];
+    Child *ch;
 
     XSync(dpy, False);
 
     /* main event loop */
     while (running) {
+        /* publish whatever the last wakeup changed in one write each */
+        updateclientlist();
+        journalflush();
+        /* SIGCHLD is left at its default, catch what childadopt() missed */
+        if (havepidfd)
+            childsweep();
+        XFlush(dpy);
         event_count = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
 
         for (int i = 0; i < event_count; i++) {
@@ -1788,11 +3647,21 @@ run(void)
                 // -1 means EPOLLHUP
                 if (handlexevent(events + i) == -1)
                     return;
+            } else if (event_fd == anim_fd) {
+                animtick();
+            } else if (event_fd == title_fd) {
+                titletick();
+            } else if ((ch = childbyfd(event_fd))) {
+                reapchild(ch);
+            } else if (event_fd == sup_fd) {
+                supervisetick();
             } else if (event_fd == ipc_get_sock_fd()) {
                 ipc_handle_socket_epoll_event(events + i);
             } else if (ipc_is_client_registered(event_fd)) {
                 if (ipc_handle_client_epoll_event(events + i, mons, &lastselmon, selmon,
-                                                  tags, LENGTH(tags), layouts, LENGTH(layouts)) < 0) {
+                                                  tags, LENGTH(tags), layouts, LENGTH(layouts),
+                                                  launches, nlaunches,
+                                                  supervised, nsupervised) < 0) {
                     fprintf(stderr, "Error handling IPC event on fd %d\n", event_fd);
                 }
             } else {
@@ -1803,7 +3672,6 @@ run(void)
                 return;
             }
         }
-        checkedgeswitch();
     }
 }
 
@@ -1826,32 +3694,102 @@ run(void)
 void
 scan(void)
 {
-	unsigned int i, num;
+	unsigned int i, num, n = 0;
 	Window d1, d2, *wins = NULL;
-	XWindowAttributes wa;
+	xcb_get_window_attributes_cookie_t *ac;
+	xcb_get_property_cookie_t *tc, *sc, *cc;
+	xcb_get_window_attributes_reply_t *attr;
+	xcb_get_property_reply_t *trans, *state, *class;
+	xcb_generic_error_t *err;
+	char *kind; /* 0 leave alone, 1 manage, 2 manage after the others */
+	char *str, buf[256];
+	int len, off, istrans, isbar, mapped;
+	unsigned int restored;
+	struct timespec t;
+	double tquery, tattrs, tmanage;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	if (!XQueryTree(dpy, root, &d1, &d2, &wins, &num))
+		return;
+	tquery = lap(&t);
+	/* windows a restart snapshot brings back come out as None */
+	if (snapbuf) {
+		restored = snapshotrestore(wins, num);
+		free(snapbuf);
+		snapbuf = NULL;
+		fprintf(stderr, "dwm: scan: %u clients restored in %.2fms\n", restored, lap(&t));
+		ipc_restart_event(restored);
+	}
 
-	if (XQueryTree(dpy, root, &d1, &d2, &wins, &num)) {
-		for (i = 0; i < num; i++) {
-			if (!XGetWindowAttributes(dpy, wins[i], &wa)
-                || wa.override_redirect || XGetTransientForHint(dpy, wins[i], &d1))
-				continue;
-			if (wmclasscontains(wins[i], altbarclass, ""))
-				managealtbar(wins[i], &wa);
-			else if (wa.map_state == IsViewable || getstate(wins[i]) == IconicState)
-				manage(wins[i], &wa);
-		}
-		for (i = 0; i < num; i++) { /* now the transients */
-			if (!XGetWindowAttributes(dpy, wins[i], &wa))
-				continue;
-			if (XGetTransientForHint(dpy, wins[i], &d1)
-                && (wa.map_state == IsViewable || getstate(wins[i]) == IconicState))
-				manage(wins[i], &wa);
+	/* ask for everything the filter below needs in one burst */
+	ac = ecalloc(num, sizeof(*ac));
+	tc = ecalloc(num, sizeof(*tc));
+	sc = ecalloc(num, sizeof(*sc));
+	cc = ecalloc(num, sizeof(*cc));
+	kind = ecalloc(num, 1);
+	for (i = 0; i < num; i++) {
+		if (!wins[i])
+			continue;
+		ac[i] = xcb_get_window_attributes(xcon, wins[i]);
+		tc[i] = xcb_get_property(xcon, 0, wins[i], XA_WM_TRANSIENT_FOR, XA_WINDOW, 0, 1);
+		sc[i] = xcb_get_property(xcon, 0, wins[i], wmatom[WMState], wmatom[WMState], 0, 2);
+		cc[i] = xcb_get_property(xcon, 0, wins[i], XA_WM_CLASS, XA_STRING, 0, 128);
+	}
+	for (i = 0; i < num; i++) {
+		if (!wins[i])
+			continue;
+		attr = xcb_get_window_attributes_reply(xcon, ac[i], &err);
+		free(err);
+		trans = xcb_get_property_reply(xcon, tc[i], &err);
+		free(err);
+		state = xcb_get_property_reply(xcon, sc[i], &err);
+		free(err);
+		class = xcb_get_property_reply(xcon, cc[i], &err);
+		free(err);
+		if (attr && !attr->override_redirect) {
+			istrans = trans && trans->format == 32 && trans->value_len;
+			isbar = 0;
+			if (!istrans && class && (len = xcb_get_property_value_length(class)) > 0) {
+				str = xcb_get_property_value(class);
+				off = strnlen(str, len) + 1; /* skip the instance */
+				snprintf(buf, sizeof buf, "%.*s", MAX(len - off, 0), str + MIN(off, len));
+				isbar = strstr(buf, altbarclass) != NULL;
+			}
+			mapped = attr->map_state == XCB_MAP_STATE_VIEWABLE
+				|| (state && state->format == 32 && state->value_len
+				&& *(uint32_t *)xcb_get_property_value(state) == IconicState);
+			if (mapped || isbar) /* the bar is taken even when unmapped */
+				kind[i] = istrans ? 2 : 1;
 		}
-		if (wins)
-			XFree(wins);
+		free(attr);
+		free(trans);
+		free(state);
+		free(class);
 	}
+	tattrs = lap(&t);
+
+	/* transients go last so they find the clients they belong to */
+	for (i = 0; i < num; i++)
+		if (kind[i] == 1 && ++n)
+			managerequest(wins[i]);
+	for (i = 0; i < num; i++)
+		if (kind[i] == 2 && ++n)
+			managerequest(wins[i]);
+	manageflush();
+	tmanage = lap(&t);
+
+	free(ac);
+	free(tc);
+	free(sc);
+	free(cc);
+	free(kind);
+	if (wins)
+		XFree(wins);
+	fprintf(stderr, "dwm: scan: %u of %u windows in %.2fms (query %.2f, attributes %.2f, manage %.2f)\n",
+		n, num, tquery + tattrs + tmanage, tquery, tattrs, tmanage);
 }
 
+
 /* void */
 /* scan(void) */
 /* { */
@@ -1880,20 +3818,159 @@ scan(void)
 /* } */
 
 void
-sendmon(Client *c, Monitor *m)
+sendmon(Client *c, Monitor *m)
+{
+	if (c->mon == m)
+		return;
+	unfocus(c, 1);
+	detach(c);
+	detachstack(c);
+	griddel(c);
+	c->mon = m;
+	c->info->homeoutput = None; /* moved on purpose, stays here */
+	c->tags = m->tagset[m->seltags]; /* assign tags of target monitor */
+	c->row = m->row[m->seltags];
+	gridadd(c);
+	attach(c);
+	attachstack(c);
+	setclienttagprop(c);
+	focus(NULL);
+	arrange(NULL);
+}
+
+/* sessionpath with a leading ~/ resolved against $HOME */
+int
+sessionfile(char *path, size_t len)
+{
+	const char *home = getenv("HOME");
+
+	if (!sessionpath)
+		return 0;
+	if (!strncmp(sessionpath, "~/", 2))
+		return home && (size_t)snprintf(path, len, "%s%s", home, sessionpath + 1) < len;
+	return (size_t)snprintf(path, len, "%s", sessionpath) < len;
+}
+
+/* relaunches what sessionsave() wrote; applysession() then puts each
+ * window where it was as it is managed */
+void
+sessionload(const Arg *arg)
+{
+	char path[512], *line = NULL, *field[12 + SESSIONARGS], *p;
+	const char *argv[LENGTH(field) - 12 + 1];
+	size_t cap = 0;
+	unsigned int i, n, h;
+	SessionEntry *e;
+	FILE *f;
+
+	if (!sessionfile(path, sizeof path) || !(f = fopen(path, "r")))
+		return;
+	free(sessions);
+	sessions = NULL;
+	nsessions = 0;
+	memset(sessionhead, 0, sizeof sessionhead);
+	sessionloaded = nowms();
+	while (getline(&line, &cap, f) > 0) {
+		line[strcspn(line, "\n")] = '\0';
+		for (n = 0, p = line; p && n < LENGTH(field); n++) {
+			field[n] = p;
+			if ((p = strchr(p, '\t')))
+				*p++ = '\0';
+		}
+		if (n < 13)
+			continue;
+		if (p) {
+			fprintf(stderr, "dwm: session: skipping %s, more than %d arguments\n",
+				field[12], SESSIONARGS);
+			continue;
+		}
+		if (!(sessions = realloc(sessions, (nsessions + 1) * sizeof(SessionEntry))))
+			die("realloc:");
+		e = &sessions[nsessions];
+		memset(e, 0, sizeof(SessionEntry));
+		e->savedpid = atoi(field[0]);
+		e->mon = atoi(field[1]);
+		e->tags = strtoul(field[2], NULL, 10);
+		e->row = strtoul(field[3], NULL, 10);
+		e->pos = strtoul(field[4], NULL, 10);
+		e->isfloating = atoi(field[5]);
+		e->x = atoi(field[6]);
+		e->y = atoi(field[7]);
+		e->w = atoi(field[8]);
+		e->h = atoi(field[9]);
+		e->class = intern(field[10]);
+		e->instance = intern(field[11]);
+		/* windows of one process share a single relaunch */
+		for (i = 0; i < nsessions && sessions[i].savedpid != e->savedpid; i++);
+		if (i < nsessions) {
+			e->pid = sessions[i].pid;
+		} else {
+			for (i = 12; i < n; i++)
+				argv[i - 12] = field[i];
+			argv[n - 12] = NULL;
+			if ((e->pid = spawnpid(argv)) <= 0)
+				continue;
+		}
+		h = (strhash(e->class) ^ strhash(e->instance)) & (LENGTH(sessionhead) - 1);
+		e->next = sessionhead[h];
+		sessionhead[h] = ++nsessions;
+	}
+	free(line);
+	fclose(f);
+}
+
+/* writes one line per window: what to run, from /proc, and where it was */
+void
+sessionsave(const Arg *arg)
 {
-	if (c->mon == m)
+	char path[512], tmp[520], buf[32], cmd[4096], *parent;
+	unsigned int pos, argc;
+	ssize_t n, i;
+	Monitor *m;
+	Client *c;
+	FILE *f;
+	int fd;
+
+	if (!sessionfile(path, sizeof path))
 		return;
-	unfocus(c, 1);
-	detach(c);
-	detachstack(c);
-	c->mon = m;
-	c->tags = m->tagset[m->seltags]; /* assign tags of target monitor */
-	attach(c);
-	attachstack(c);
-	setclienttagprop(c);
-	focus(NULL);
-	arrange(NULL);
+	if (parentdir(path, &parent) == 0) {
+		mkdirp(parent);
+		free(parent);
+	}
+	snprintf(tmp, sizeof tmp, "%s.tmp", path);
+	if (!(f = fopen(tmp, "w")))
+		return;
+	for (m = mons; m; m = m->next)
+		for (pos = 0, c = m->clients; c; c = c->next, pos++) {
+			/* scratchpads and the pool are started by dwm itself */
+			if (!c->info->pid || c->tags & ~TAGMASK
+			|| strpbrk(c->info->class, "\t\n") || strpbrk(c->info->instance, "\t\n"))
+				continue;
+			snprintf(buf, sizeof buf, "/proc/%u/cmdline", (unsigned int)c->info->pid);
+			if ((fd = open(buf, O_RDONLY|O_CLOEXEC)) == -1)
+				continue;
+			n = read(fd, cmd, sizeof cmd - 1);
+			close(fd);
+			if (n <= 0 || memchr(cmd, '\t', n) || memchr(cmd, '\n', n))
+				continue;
+			for (i = 0, argc = 1; i < n - 1; i++)
+				if (!cmd[i]) {
+					cmd[i] = '\t';
+					argc++;
+				}
+			cmd[n] = '\0';
+			/* a cut off command would relaunch as something else */
+			if (n == sizeof cmd - 1 || argc > SESSIONARGS) {
+				fprintf(stderr, "dwm: session: not saving %s, command line too long\n",
+					c->info->class);
+				continue;
+			}
+			fprintf(f, "%d\t%d\t%u\t%u\t%u\t%d\t%d\t%d\t%d\t%d\t%s\t%s\t%s\n",
+				(int)c->info->pid, m->num, c->tags, c->row, pos, c->isfloating,
+				c->x, c->y, c->w, c->h, c->info->class, c->info->instance, cmd);
+		}
+	if (fclose(f) == EOF || rename(tmp, path) == -1)
+		unlink(tmp);
 }
 
 void
@@ -1935,25 +4012,32 @@ sendevent(Client *c, Atom proto)
 	int n;
 	Atom *protocols;
 	int exists = 0;
-	XEvent ev;
 
 	if (XGetWMProtocols(dpy, c->win, &protocols, &n)) {
 		while (!exists && n--)
 			exists = protocols[n] == proto;
 		XFree(protocols);
 	}
-	if (exists) {
-		ev.type = ClientMessage;
-		ev.xclient.window = c->win;
-		ev.xclient.message_type = wmatom[WMProtocols];
-		ev.xclient.format = 32;
-		ev.xclient.data.l[0] = proto;
-		ev.xclient.data.l[1] = CurrentTime;
-		XSendEvent(dpy, c->win, False, NoEventMask, &ev);
-	}
+	if (exists)
+		sendprotocol(c, proto);
 	return exists;
 }
 
+/* the WM_PROTOCOLS message for proto, whether or not c takes part in it */
+void
+sendprotocol(Client *c, Atom proto)
+{
+	XEvent ev;
+
+	ev.type = ClientMessage;
+	ev.xclient.window = c->win;
+	ev.xclient.message_type = wmatom[WMProtocols];
+	ev.xclient.format = 32;
+	ev.xclient.data.l[0] = proto;
+	ev.xclient.data.l[1] = CurrentTime;
+	XSendEvent(dpy, c->win, False, NoEventMask, &ev);
+}
+
 void
 setnumdesktops(void){
 	long data[] = { TAGSLENGTH };
@@ -2037,6 +4121,44 @@ setmfact(const Arg *arg)
 	arrange(selmon);
 }
 
+void
+setsizehints(Client *c, XSizeHints *size)
+{
+	if (size->flags & PBaseSize) {
+		c->info->basew = size->base_width;
+		c->info->baseh = size->base_height;
+	} else if (size->flags & PMinSize) {
+		c->info->basew = size->min_width;
+		c->info->baseh = size->min_height;
+	} else
+		c->info->basew = c->info->baseh = 0;
+	if (size->flags & PResizeInc) {
+		c->info->incw = size->width_inc;
+		c->info->inch = size->height_inc;
+	} else
+		c->info->incw = c->info->inch = 0;
+	if (size->flags & PMaxSize) {
+		c->info->maxw = size->max_width;
+		c->info->maxh = size->max_height;
+	} else
+		c->info->maxw = c->info->maxh = 0;
+	if (size->flags & PMinSize) {
+		c->info->minw = size->min_width;
+		c->info->minh = size->min_height;
+	} else if (size->flags & PBaseSize) {
+		c->info->minw = size->base_width;
+		c->info->minh = size->base_height;
+	} else
+		c->info->minw = c->info->minh = 0;
+	if (size->flags & PAspect) {
+		c->info->mina = (float)size->min_aspect.y / size->min_aspect.x;
+		c->info->maxa = (float)size->max_aspect.x / size->max_aspect.y;
+	} else
+		c->info->maxa = c->info->mina = 0.0;
+	c->isfixed = (c->info->maxw && c->info->maxh && c->info->maxw == c->info->minw && c->info->maxh == c->info->minh);
+	c->info->hintsvalid = 1;
+}
+
 void
 setup(void)
 {
@@ -2044,27 +4166,55 @@ setup(void)
 	XSetWindowAttributes wa;
 	Atom utf8string;
 	struct sigaction sa;
+	struct timespec t;
+	double tfonts, tgeom, tatoms, tbars, tewmh, tevents;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
 
-	/* do not transform children into zombies when they terminate */
+	/* children are reaped when their pidfd turns readable, see
+	 * reapchild(); without pidfds the kernel reaps them unseen */
+	if ((i = pidfdopen(getpid())) != -1) {
+		close(i);
+		havepidfd = 1;
+	}
 	sigemptyset(&sa.sa_mask);
-	sa.sa_flags = SA_NOCLDSTOP | SA_NOCLDWAIT | SA_RESTART;
-	sa.sa_handler = SIG_IGN;
+	sa.sa_flags = SA_NOCLDSTOP | SA_RESTART | (havepidfd ? 0 : SA_NOCLDWAIT);
+	sa.sa_handler = havepidfd ? SIG_DFL : SIG_IGN;
 	sigaction(SIGCHLD, &sa, NULL);
 
-	/* clean up any zombies (inherited from .xinitrc etc) immediately */
-	while (waitpid(-1, NULL, WNOHANG) > 0);
+	/* clean up any zombies (inherited from .xinitrc etc) immediately,
+	 * or watch them like our own */
+	if (havepidfd)
+		childadopt();
+	else
+		while (waitpid(-1, NULL, WNOHANG) > 0);
 
 	/* init screen */
 	screen = DefaultScreen(dpy);
 	sw = DisplayWidth(dpy, screen);
 	sh = DisplayHeight(dpy, screen);
 	root = RootWindow(dpy, screen);
+	xcon = XGetXCBConnection(dpy);
 	drw = drw_create(dpy, screen, root, sw, sh);
 	if (!drw_fontset_create(drw, fonts, LENGTH(fonts)))
 		die("no fonts could be loaded.");
 	lrpad = drw->fonts->h;
 	bh = usealtbar ? 0 : drw->fonts->h + 2;
+	tfonts = lap(&t);
+#ifdef XRANDR
+	int rrerror, rrmajor, rrminor;
+
+	if (XRRQueryExtension(dpy, &rrbase, &rrerror) && XRRQueryVersion(dpy, &rrmajor, &rrminor)
+	&& (rrmajor > 1 || (rrmajor == 1 && rrminor >= 5)))
+		XRRSelectInput(dpy, root, RRScreenChangeNotifyMask|RRCrtcChangeNotifyMask
+			|RROutputChangeNotifyMask);
+	else
+		rrbase = -1;
+#endif /* XRANDR */
 	updategeom();
+	updaterefresh();
+	compilerules();
+	tgeom = lap(&t);
 
 	/* init atoms */
 	utf8string = XInternAtom(dpy, "UTF8_STRING", False);
@@ -2081,11 +4231,14 @@ setup(void)
 	netatom[NetWMWindowType] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE", False);
 	netatom[NetWMWindowTypeDialog] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_DIALOG", False);
 	netatom[NetClientList] = XInternAtom(dpy, "_NET_CLIENT_LIST", False);
+	netatom[NetClientListStacking] = XInternAtom(dpy, "_NET_CLIENT_LIST_STACKING", False);
 	netatom[NetDesktopViewport] = XInternAtom(dpy, "_NET_DESKTOP_VIEWPORT", False);
 	netatom[NetNumberOfDesktops] = XInternAtom(dpy, "_NET_NUMBER_OF_DESKTOPS", False);
 	netatom[NetCurrentDesktop] = XInternAtom(dpy, "_NET_CURRENT_DESKTOP", False);
 	netatom[NetDesktopNames] = XInternAtom(dpy, "_NET_DESKTOP_NAMES", False);
 	netatom[NetClientInfo] = XInternAtom(dpy, "_NET_CLIENT_INFO", False);
+	netatom[NetWMPid] = XInternAtom(dpy, "_NET_WM_PID", False);
+	tatoms = lap(&t);
 
 	/* init cursors */
 	cursor[CurNormal] = drw_cur_create(drw, XC_left_ptr);
@@ -2099,7 +4252,9 @@ setup(void)
 
 	/* init bars */
 	updatebars();
+	updateedges();
 	updatestatus();
+	tbars = lap(&t);
 
 	/* supporting window for NetWMCheck */
 	wmcheckwin = XCreateSimpleWindow(dpy, root, 0, 0, 1, 1, 0, 0, 0);
@@ -2120,12 +4275,14 @@ setup(void)
 
 	/* clear client list properties */
 	XDeleteProperty(dpy, root, netatom[NetClientList]);
+	XDeleteProperty(dpy, root, netatom[NetClientListStacking]);
 	XDeleteProperty(dpy, root, netatom[NetClientInfo]);
+	tewmh = lap(&t);
 
 	/* select events */
 	wa.cursor = cursor[CurNormal]->cursor;
 	wa.event_mask = SubstructureRedirectMask|SubstructureNotifyMask
-		|ButtonPressMask|PointerMotionMask|EnterWindowMask
+		|ButtonPressMask|EnterWindowMask
 		|LeaveWindowMask|StructureNotifyMask|PropertyChangeMask;
 	XChangeWindowAttributes(dpy, root, CWEventMask|CWCursor, &wa);
 	XSelectInput(dpy, root, wa.event_mask);
@@ -2133,12 +4290,16 @@ setup(void)
 	focus(NULL);
     setupepoll();
 	spawnbar();
+	tevents = lap(&t);
+	fprintf(stderr, "dwm: setup: %.2fms (fonts %.2f, monitors %.2f, atoms %.2f, bars %.2f, ewmh %.2f, events %.2f)\n",
+		tfonts + tgeom + tatoms + tbars + tewmh + tevents,
+		tfonts, tgeom, tatoms, tbars, tewmh, tevents);
 }
 
 void
 setupepoll(void)
 {
-    epoll_fd = epoll_create1(0);
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
     dpy_fd = ConnectionNumber(dpy);
     struct epoll_event dpy_event;
     // Initialize struct to 0
@@ -2154,9 +4315,51 @@ setupepoll(void)
         close(epoll_fd);
         exit(1);
     }
-    if (ipc_init(ipcsockpath, epoll_fd, ipccommands, LENGTH(ipccommands)) < 0) {
+    /* a restart snapshot carries the socket and connections to keep */
+    SnapHeader sh = { .ipcoff = 0 };
+    if (snapbuf)
+        memcpy(&sh, snapbuf, sizeof sh);
+    if (ipc_init(ipcsockpath, epoll_fd, ipccommands, LENGTH(ipccommands),
+            sh.ipcoff ? snapbuf + sh.ipcoff : NULL, sh.ipcoff ? snapbuflen - sh.ipcoff : 0) < 0) {
         fputs("Failed to initialize IPC\n", stderr);
     }
+    /* restart timer for crashed supervised children */
+    if ((sup_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK|TFD_CLOEXEC)) != -1) {
+        dpy_event.events = EPOLLIN;
+        dpy_event.data.fd = sup_fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sup_fd, &dpy_event)) {
+            close(sup_fd);
+            sup_fd = -1;
+        }
+    }
+    /* autostart spawns that failed before sup_fd existed */
+    supervisearm();
+    /* children started before there was an epoll set */
+    for (unsigned int i = 0; i < nchildren; i++) {
+        dpy_event.events = EPOLLIN;
+        dpy_event.data.fd = children[i].pidfd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, children[i].pidfd, &dpy_event);
+    }
+    /* frame timer for slide animations, armed only while sliding */
+    if ((anim_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK|TFD_CLOEXEC)) != -1) {
+        dpy_event.events = EPOLLIN;
+        dpy_event.data.fd = anim_fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, anim_fd, &dpy_event)) {
+            close(anim_fd);
+            anim_fd = -1;
+        }
+    }
+    if (anim_fd == -1)
+        fputs("Failed to create animation timer, slides disabled\n", stderr);
+    /* coalesces title changes, armed only while a watched title is stale */
+    if ((title_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK|TFD_CLOEXEC)) != -1) {
+        dpy_event.events = EPOLLIN;
+        dpy_event.data.fd = title_fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, title_fd, &dpy_event)) {
+            close(title_fd);
+            title_fd = -1;
+        }
+    }
 }
 
 
@@ -2252,14 +4455,44 @@ setviewport(void){
 void
 seturgent(Client *c, int urg)
 {
-	XWMHints *wmh;
+	XWMHints *wmh = &c->info->wmh;
+	long flags;
 
 	c->isurgent = urg;
-	if (!(wmh = XGetWMHints(dpy, c->win)))
+	if (!c->info->haswmh)
+		return;
+	flags = urg ? (wmh->flags | XUrgencyHint) : (wmh->flags & ~XUrgencyHint);
+	if (flags == wmh->flags)
 		return;
-	wmh->flags = urg ? (wmh->flags | XUrgencyHint) : (wmh->flags & ~XUrgencyHint);
+	wmh->flags = flags;
+	c->info->wmhsent++;
 	XSetWMHints(dpy, c->win, wmh);
-	XFree(wmh);
+}
+
+void
+setwindowtype(Client *c, Atom state, Atom wtype)
+{
+	if (state == netatom[NetWMFullscreen])
+		setfullscreen(c, 1);
+	if (wtype == netatom[NetWMWindowTypeDialog])
+		c->isfloating = 1;
+}
+
+void
+setwmhints(Client *c, XWMHints *wmh)
+{
+	c->info->wmh = *wmh;
+	c->info->haswmh = 1;
+	if (c == selmon->sel && wmh->flags & XUrgencyHint) {
+		c->info->wmh.flags &= ~XUrgencyHint;
+		c->info->wmhsent++;
+		XSetWMHints(dpy, c->win, &c->info->wmh);
+	} else
+		c->isurgent = (wmh->flags & XUrgencyHint) ? 1 : 0;
+	if (wmh->flags & InputHint)
+		c->neverfocus = !wmh->input;
+	else
+		c->neverfocus = 0;
 }
 
 
@@ -2268,64 +4501,38 @@ seturgent(Client *c, int urg)
 void
 showhide(Client *c)
 {
+    int x, y;
+
     if (!c)
         return;
     if (ISVISIBLE(c)) {
         /* show clients top down */
-        XMoveWindow(dpy, c->win, c->x, c->y);
+        if (animview && !INVIEW(c, c->mon->seltags ^ 1)) {
+            // Slide in from the side of the view we are leaving
+            hidepos(c, c->mon->tagset[c->mon->seltags ^ 1],
+                    c->mon->row[c->mon->seltags ^ 1], &x, &y);
+            animstart(c, x, y, c->x, c->y);
+        } else if (c->animframe) {
+            // Still sliding in, just retarget the slide
+            c->tx = c->x;
+            c->ty = c->y;
+            c->tw = c->w;
+            c->th = c->h;
+        } else
+            XMoveWindow(dpy, c->win, c->ax = c->x, c->ay = c->y);
         if (!c->mon->lt[c->mon->sellt]->arrange || c->isfloating)
             resize(c, c->x, c->y, c->w, c->h, 0);
         showhide(c->snext);
     } else {
         /* hide clients bottom up */
         showhide(c->snext);
-        
-        // Get client's original position relative to monitor edge
-        int relative_x = c->x - c->mon->mx;
-        int relative_y = c->y - c->mon->my;
-        
-        // Get the single active tag number for current client
-        int client_tag = 0;
-        for (int i = 0; i < LENGTH(tags); i++) {
-            if (c->tags & (1 << i)) {
-                client_tag = i + 1;
-                break;
-            }
-        }
-        
-        // Get currently selected tag
-        int selected_tag = 0;
-        for (int i = 0; i < LENGTH(tags); i++) {
-            if (c->mon->tagset[c->mon->seltags] & (1 << i)) {
-                selected_tag = i + 1;
-                break;
-            }
-        }
-
-        if (isVerticalMove) {
-            // Vertical movement
-            if (client_tag > selected_tag) {
-                // Move down
-                XMoveWindow(dpy, c->win, c->x, c->mon->mh + relative_y);
-            } else if (client_tag < selected_tag) {
-                // Move up
-                XMoveWindow(dpy, c->win, c->x, -c->mon->mh + relative_y);
-            } else {
-                // Fallback (shouldn't happen in normal operation)
-                XMoveWindow(dpy, c->win, c->x, -c->mon->mh + relative_y);
-            }
-        } else {
-            // Horizontal movement (original behavior)
-            if (client_tag > selected_tag) {
-                // Move right
-                XMoveWindow(dpy, c->win, c->mon->mw + relative_x, c->y);
-            } else if (client_tag < selected_tag) {
-                // Move left
-                XMoveWindow(dpy, c->win, -c->mon->mw + relative_x, c->y);
-            } else {
-                // Fallback (shouldn't happen in normal operation)
-                XMoveWindow(dpy, c->win, -c->mon->mw + relative_x, c->y);
-            }
+        hidepos(c, c->mon->tagset[c->mon->seltags],
+                c->mon->row[c->mon->seltags], &x, &y);
+        if (animview && INVIEW(c, c->mon->seltags ^ 1))
+            animstart(c, c->ax, c->ay, x, y);
+        else {
+            c->animframe = 0;
+            XMoveWindow(dpy, c->win, c->ax = x, c->ay = y);
         }
     }
 }
@@ -2436,41 +4643,734 @@ showhide(Client *c)
 /*     } */
 /* } */
 
+/* p is c itself or the terminal c swallowed */
 void
-spawn(const Arg *arg)
+snapclient(Client *p, Client *c, SnapClient *sc)
 {
-	struct sigaction sa;
+	Client *t;
+	unsigned int pos;
+
+	memset(sc, 0, sizeof(SnapClient));
+	for (pos = 0, t = c->mon->stack; t && t != p; t = t->snext, pos++);
+	sc->win = p->win;
+	sc->tags = p->tags;
+	sc->row = p->row;
+	sc->stackpos = pos;
+	sc->swallowed = p == c ? None : c->win;
+	sc->x = p->x; sc->y = p->y; sc->w = p->w; sc->h = p->h; sc->bw = p->bw;
+	sc->ax = p->ax; sc->ay = p->ay; sc->aw = p->aw; sc->ah = p->ah;
+	sc->oldx = p->oldx; sc->oldy = p->oldy; sc->oldw = p->oldw; sc->oldh = p->oldh;
+	sc->oldbw = p->oldbw;
+	sc->isfixed = p->isfixed;
+	sc->isfloating = p->isfloating;
+	sc->isurgent = p->isurgent;
+	sc->neverfocus = p->neverfocus;
+	sc->oldstate = p->oldstate;
+	sc->isfullscreen = p->isfullscreen;
+	sc->pid = p->info->pid;
+	sc->isterminal = p->info->isterminal;
+	sc->noswallow = p->info->noswallow;
+	sc->rulekey = p->info->rulekey;
+	sc->haswmh = p->info->haswmh;
+	sc->wmh = p->info->wmh;
+	sc->prevstate = p->prevstate;
+}
+
+void
+snapheader(SnapHeader *h)
+{
+	Monitor *m;
+
+	memset(h, 0, sizeof(SnapHeader));
+	memcpy(h->magic, SNAPMAGIC, sizeof h->magic);
+	h->monsize = sizeof(SnapMon);
+	h->clientsize = sizeof(SnapClient);
+	h->spmask = SPTAGMASK;
+	h->poolmask = POOLTAGMASK;
+	h->nsup = nsupervised;
+	for (m = mons; m; m = m->next, h->nmons++)
+		if (m == selmon)
+			h->selmon = h->nmons;
+}
+
+void
+snapmon(Monitor *m, SnapMon *sm)
+{
+	Client *c;
+	unsigned int i;
+
+	memset(sm, 0, sizeof(SnapMon));
+	sm->mfact = m->mfact;
+	sm->nmaster = m->nmaster;
+	sm->gappx = m->gappx;
+	sm->showbar = m->showbar;
+	sm->topbar = m->topbar;
+	sm->seltags = m->seltags;
+	sm->sellt = m->sellt;
+	for (i = 0; i < 2; i++) {
+		sm->tagset[i] = m->tagset[i];
+		sm->row[i] = m->row[i];
+		sm->lt[i] = m->lt[i] - layouts;
+	}
+	for (i = 0; i < LENGTH(tags); i++)
+		sm->colrow[i] = m->cols[i].row;
+	sm->sel = m->sel ? m->sel->win : None;
+	sm->tagstate[0] = m->tagstate.selected;
+	sm->tagstate[1] = m->tagstate.occupied;
+	sm->tagstate[2] = m->tagstate.urgent;
+	memcpy(sm->lastltsymbol, m->lastltsymbol, sizeof sm->lastltsymbol);
+	sm->lastlt = m->lastlt ? (uint32_t)(m->lastlt - layouts) : LENGTH(layouts);
+	sm->lastsel = m->lastsel ? m->lastsel->win : None;
+	for (c = m->clients; c; c = c->next)
+		sm->nclients += c->info->swallowing ? 2 : 1;
+}
+
+/* takes the snapshot self_restart() left in the fd named by DWM_SNAPSHOT;
+ * anything that does not look like one of ours is dropped */
+void
+snapshotload(void)
+{
+	const char *env = getenv("DWM_SNAPSHOT");
+	struct stat st;
+	SnapHeader h;
+	size_t off;
+	ssize_t n;
+	int fd;
+
+	if (!env)
+		return;
+	fd = atoi(env);
+	unsetenv("DWM_SNAPSHOT");
+	if (fd < 3 || fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof h) {
+		if (fd >= 3)
+			close(fd);
+		return;
+	}
+	snapbuf = ecalloc(1, st.st_size);
+	for (off = 0; off < (size_t)st.st_size; off += n)
+		if ((n = pread(fd, snapbuf + off, st.st_size - off, off)) <= 0)
+			break;
+	close(fd);
+	memcpy(&h, snapbuf, sizeof h);
+	if (off < (size_t)st.st_size || memcmp(h.magic, SNAPMAGIC, sizeof h.magic)
+	|| h.monsize != sizeof(SnapMon) || h.clientsize != sizeof(SnapClient)
+	|| sizeof h + h.nsup * sizeof(SnapSup) > off || h.ipcoff > off) {
+		fputs("dwm: ignoring unusable restart snapshot\n", stderr);
+		free(snapbuf);
+		snapbuf = NULL;
+		return;
+	}
+	snapbuflen = off;
+}
+
+int
+snapshotread(size_t *off, void *dst, size_t len)
+{
+	if (len > snapbuflen - *off)
+		return 0;
+	memcpy(dst, snapbuf + *off, len);
+	*off += len;
+	return 1;
+}
+
+/* rebuilds monitors and clients from the snapshot without a single
+ * property request; only windows XQueryTree still lists come back, and
+ * their slots in wins are cleared so scan() leaves them alone */
+unsigned int
+snapshotrestore(Window *wins, unsigned int num)
+{
+	SnapHeader h;
+	SnapMon sm;
+	SnapClient sc;
+	Monitor *m, *sel = NULL;
+	Client *c, *prev, **tail = NULL, **stack = NULL;
+	const char *name, *class, *instance;
+	size_t off = sizeof h;
+	unsigned int i, j, k, n = 0, tagmask;
+	Window *sorted, *w;
+
+	memcpy(&h, snapbuf, sizeof h);
+	off += h.nsup * sizeof(SnapSup);
+	/* hidden tags mean nothing once scratchpads or pools were reconfigured */
+	tagmask = TAGMASK | (h.spmask == SPTAGMASK ? SPTAGMASK : 0)
+		| (h.poolmask == POOLTAGMASK ? POOLTAGMASK : 0);
+	sorted = ecalloc(num, sizeof(Window));
+	memcpy(sorted, wins, num * sizeof(Window));
+	qsort(sorted, num, sizeof(Window), windowcmp);
+	for (i = 0, m = mons; i < h.nmons; i++, m = m ? m->next : NULL) {
+		if (!snapshotread(&off, &sm, sizeof sm))
+			break;
+		if (m) {
+			m->mfact = sm.mfact;
+			m->nmaster = sm.nmaster;
+			m->gappx = sm.gappx;
+			m->seltags = sm.seltags & 1;
+			m->sellt = sm.sellt & 1;
+			for (j = 0; j < 2; j++) {
+				m->tagset[j] = sm.tagset[j] & TAGMASK ? sm.tagset[j] & TAGMASK : 1;
+				m->row[j] = sm.row[j] < GRIDROWS ? sm.row[j] : 0;
+				if (sm.lt[j] < LENGTH(layouts))
+					m->lt[j] = &layouts[sm.lt[j]];
+			}
+			strncpy(m->ltsymbol, m->lt[m->sellt]->symbol, sizeof m->ltsymbol);
+			for (j = 0; j < LENGTH(tags); j++)
+				m->cols[j].row = sm.colrow[j] < GRIDROWS ? sm.colrow[j] : 0;
+			/* so subscribers only hear about what really changed */
+			m->tagstate.selected = sm.tagstate[0];
+			m->tagstate.occupied = sm.tagstate[1];
+			m->tagstate.urgent = sm.tagstate[2];
+			memcpy(m->lastltsymbol, sm.lastltsymbol, sizeof m->lastltsymbol);
+			m->lastltsymbol[sizeof m->lastltsymbol - 1] = '\0';
+			m->lastlt = sm.lastlt < LENGTH(layouts) ? &layouts[sm.lastlt] : NULL;
+			if (m->showbar != sm.showbar || m->topbar != sm.topbar) {
+				m->showbar = sm.showbar;
+				m->topbar = sm.topbar;
+				updatebarpos(m);
+			}
+			if (h.selmon == i)
+				sel = m;
+			free(stack);
+			stack = ecalloc(sm.nclients + 1, sizeof(Client *));
+			for (tail = &m->clients; *tail; tail = &(*tail)->next);
+		}
+		for (j = 0, prev = NULL; j < sm.nclients; j++) {
+			if (!snapshotread(&off, &sc, sizeof sc)
+			|| !(name = snapshotstr(&off)) || !(class = snapshotstr(&off))
+			|| !(instance = snapshotstr(&off)))
+				goto done;
+			if (!m || !(w = bsearch(&sc.win, sorted, num, sizeof(Window), windowcmp)))
+				continue;
+			if (sc.swallowed && (!prev || prev->win != sc.swallowed))
+				continue;
+			c = clientalloc();
+			c->win = sc.win;
+			c->mon = m;
+			c->tags = sc.tags & tagmask ? sc.tags & tagmask : m->tagset[m->seltags];
+			c->row = sc.row < GRIDROWS ? sc.row : 0;
+			c->x = sc.x; c->y = sc.y; c->w = sc.w; c->h = sc.h; c->bw = sc.bw;
+			c->ax = sc.ax; c->ay = sc.ay; c->aw = sc.aw; c->ah = sc.ah;
+			c->oldx = sc.oldx; c->oldy = sc.oldy; c->oldw = sc.oldw; c->oldh = sc.oldh;
+			c->oldbw = sc.oldbw;
+			c->isfixed = sc.isfixed;
+			c->isfloating = sc.isfloating;
+			c->isurgent = sc.isurgent;
+			c->neverfocus = sc.neverfocus;
+			c->oldstate = sc.oldstate;
+			c->isfullscreen = sc.isfullscreen;
+			c->info->name = estrdup(name);
+			c->info->namestale = 1; /* it may have changed while we were away */
+			c->info->namefetched = nowms();
+			c->info->class = intern(class);
+			c->info->instance = intern(instance);
+			c->info->pid = sc.pid;
+			c->info->isterminal = sc.isterminal;
+			c->info->noswallow = sc.noswallow;
+			c->info->rulekey = sc.rulekey;
+			c->info->haswmh = sc.haswmh;
+			c->info->wmh = sc.wmh;
+			c->prevstate = sc.prevstate;
+			XSelectInput(dpy, c->win, EnterWindowMask|FocusChangeMask|PropertyChangeMask|StructureNotifyMask);
+			grabbuttons(c, 0);
+			for (k = 0; k < num; k++)
+				if (wins[k] == c->win)
+					wins[k] = None;
+			n++;
+			if (sc.swallowed) {
+				prev->info->swallowing = c;
+				continue;
+			}
+			*tail = c;
+			tail = &c->next;
+			if (sc.stackpos < sm.nclients && !stack[sc.stackpos])
+				stack[sc.stackpos] = c;
+			else
+				attachstack(c);
+			gridadd(c);
+			clientlistadd(c->win);
+			if (c->win == sm.sel)
+				m->sel = c;
+			if (c->win == sm.lastsel)
+				m->lastsel = c;
+			prev = c;
+		}
+		if (m)
+			for (j = sm.nclients; j-- > 0;)
+				if (stack[j])
+					attachstack(stack[j]);
+	}
+done:
+	free(stack);
+	free(sorted);
+	if (sel)
+		selmon = lastselmon = sel;
+	if (n) {
+		arrange(NULL);
+		focus(NULL);
+	}
+	return n;
+}
+
+const char *
+snapshotstr(size_t *off)
+{
+	const char *s = snapbuf + *off, *e;
+
+	if (!(e = memchr(s, '\0', snapbuflen - *off)))
+		return NULL;
+	*off += e - s + 1;
+	return s;
+}
+
+/* writes everything scan() and the rules could not get back into a memfd
+ * the next image inherits; returns the fd or -1 */
+int
+snapshotwrite(void)
+{
+	SnapHeader h;
+	SnapSup ss;
+	SnapMon sm;
+	SnapClient sc;
+	Monitor *m;
+	Client *c, *p;
+	FILE *f;
+	unsigned int i;
+	int fd = -1;
+
+#ifdef SYS_memfd_create
+	fd = syscall(SYS_memfd_create, "dwm-snapshot", 0);
+#endif
+	if (fd == -1 || !(f = fdopen(dup(fd), "w"))) {
+		if (fd != -1)
+			close(fd);
+		return -1;
+	}
+	snapheader(&h);
+	fwrite(&h, sizeof h, 1, f);
+	for (i = 0; i < nsupervised; i++) {
+		snapsup(&supervised[i], &ss);
+		fwrite(&ss, sizeof ss, 1, f);
+	}
+	for (m = mons; m; m = m->next) {
+		snapmon(m, &sm);
+		fwrite(&sm, sizeof sm, 1, f);
+		for (c = m->clients; c; c = c->next)
+			for (p = c; p; p = p == c ? c->info->swallowing : NULL) {
+				snapclient(p, c, &sc);
+				fwrite(&sc, sizeof sc, 1, f);
+				fwrite(p->info->name, strlen(p->info->name) + 1, 1, f);
+				fwrite(p->info->class, strlen(p->info->class) + 1, 1, f);
+				fwrite(p->info->instance, strlen(p->info->instance) + 1, 1, f);
+			}
+	}
+	/* the IPC socket and its clients go last, their size is only known
+	 * once written */
+	h.ipcoff = ftell(f);
+	ipc_handoff(f);
+	rewind(f);
+	fwrite(&h, sizeof h, 1, f);
+	if (fclose(f) == EOF) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+void
+snapsup(Supervised *s, SnapSup *ss)
+{
+	ss->pid = s->pid;
+	ss->state = s->state;
+	ss->restarts = s->restarts;
+}
 
+void
+spawn(const Arg *arg)
+{
 	if (arg->v == dmenucmd)
 		dmenumon[0] = '0' + selmon->num;
-	if (fork() == 0) {
-		if (dpy)
-			close(ConnectionNumber(dpy));
-		setsid();
+	spawnpid(arg->v);
+}
+
+void
+setclienttagprop(Client *c)
+{
+	long data[] = { (long) c->tags, (long) c->mon->num, (long) c->row };
+	XChangeProperty(dpy, c->win, netatom[NetClientInfo], XA_CARDINAL, 32,
+			PropModeReplace, (unsigned char *) data, 3);
+}
+
+/* the bar's launch script runs under the supervisor instead of blocking
+ * setup() until it returns */
+void
+spawnbar()
+{
+	static const char *cmd[] = { "/bin/sh", "-c", NULL, NULL };
+
+	if (!*altbarcmd)
+		return;
+	cmd[2] = altbarcmd;
+	barsup = nsupervised;
+	supervise(altbarcmd, cmd);
+}
+
+/* posix_spawn runs the child on our pages until it execs, so starting a
+ * command costs the same however large we grow; the child keeps stdio
+ * and nothing else of ours */
+pid_t
+spawnpid(const void *cmd)
+{
+	char *const *argv = (char *const *)cmd;
+	posix_spawn_file_actions_t fa;
+	posix_spawnattr_t attr;
+	sigset_t none, dfl;
+	short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+	struct timespec t;
+	Child *ch;
+	pid_t pid;
+	int err;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	posix_spawn_file_actions_init(&fa);
+	if (dpy)
+		posix_spawn_file_actions_addclose(&fa, ConnectionNumber(dpy));
+	if (epoll_fd != -1)
+		posix_spawn_file_actions_addclose(&fa, epoll_fd);
+	if (ipc_get_sock_fd() != -1)
+		posix_spawn_file_actions_addclose(&fa, ipc_get_sock_fd());
+	posix_spawnattr_init(&attr);
+	sigemptyset(&none);
+	sigemptyset(&dfl);
+	sigaddset(&dfl, SIGCHLD);
+	posix_spawnattr_setsigmask(&attr, &none);
+	posix_spawnattr_setsigdefault(&attr, &dfl);
+#ifdef POSIX_SPAWN_SETSID
+	flags |= POSIX_SPAWN_SETSID;
+#else
+	/* leave our process group at least */
+	flags |= POSIX_SPAWN_SETPGROUP;
+	posix_spawnattr_setpgroup(&attr, 0);
+#endif
+	posix_spawnattr_setflags(&attr, flags);
+	err = posix_spawnp(&pid, argv[0], &fa, &attr, argv, environ);
+	posix_spawnattr_destroy(&attr);
+	posix_spawn_file_actions_destroy(&fa);
+	if (err) {
+		fprintf(stderr, "dwm: spawn '%s' failed: %s\n", argv[0], strerror(err));
+		return -1;
+	}
+	if ((ch = childwatch(pid))) {
+		ch->cmd = intern(argv[0]);
+		ch->started = t;
+	}
+	return pid;
+}
+
+/* hands out a waiting instance of a pooled command instead of starting
+ * one, then tops the pool up again in the background */
+void
+spawnpool(const Arg *arg)
+{
+	unsigned int i;
+	Client *c = NULL;
+	Monitor *m;
+
+	for (i = 0; i < LENGTH(pools) && pools[i].cmd != arg->v; i++);
+	if (i == LENGTH(pools)) {
+		spawn(arg);
+		return;
+	}
+	for (m = mons; m && !c; m = m->next)
+		for (c = m->clients; c && !(c->tags & POOLTAG(i)); c = c->next);
+	if (c) {
+		m = c->mon;
+		retag(c, selmon, selmon->tagset[selmon->seltags]);
+		if (m != selmon)
+			arrange(m);
+		focus(c);
+		arrange(selmon);
+	} else
+		spawn(arg);
+	poolfill();
+}
+
+/* starts the scratchpads that are not around yet, so toggling one later
+ * only has to move it */
+void
+spawnscratch(void)
+{
+	unsigned int i, have = 0;
+	Client *c;
+	Monitor *m;
+
+	for (m = mons; m; m = m->next)
+		for (c = m->clients; c; c = c->next)
+			have |= c->tags & SPTAGMASK;
+	for (i = 0; i < LENGTH(scratchpads); i++)
+		if (!(have & SPTAG(i)))
+			spawn(&((Arg){.v = scratchpads[i].cmd}));
+}
+
+/* FNV-1a */
+unsigned int
+strhash(const char *s)
+{
+	unsigned int h = 2166136261u;
+
+	while (*s)
+		h = (h ^ (unsigned char)*s++) * 16777619u;
+	return h;
+}
+
+/* registers cmd to be kept running under name and starts it, unless the
+ * image before a restart left it running or finished */
+void
+supervise(const char *name, const char *const *cmd)
+{
+	Supervised *s;
+	SnapSup ss;
+
+	if (!(supervised = realloc(supervised, ++nsupervised * sizeof(Supervised))))
+		die("realloc:");
+	s = &supervised[nsupervised - 1];
+	memset(s, 0, sizeof(Supervised));
+	s->name = name;
+	s->cmd = cmd;
+	/* across a restart keep what still runs or already finished */
+	if (snapbuf && nsupervised <= ((SnapHeader *)snapbuf)->nsup) {
+		memcpy(&ss, snapbuf + sizeof(SnapHeader) + (nsupervised - 1) * sizeof(SnapSup), sizeof ss);
+		s->restarts = ss.restarts;
+		s->started = nowms();
+		if (ss.state == SupDone)
+			s->state = SupDone;
+		/* only our own children: after a crash the journal names
+		 * processes of the dead dwm, or pids reused since */
+		if (ss.state == SupRunning && ss.pid > 0 && waitpid(ss.pid, NULL, WNOHANG) == 0) {
+			s->pid = ss.pid;
+			s->state = SupRunning;
+		}
+		if (s->state == SupDone || s->pid)
+			return;
+	}
+	superviserun(s);
+}
+
+/* wakes us for the earliest pending restart */
+void
+supervisearm(void)
+{
+	struct itimerspec its = {{0}};
+	long due = 0;
+	unsigned int i;
+
+	if (sup_fd == -1)
+		return;
+	for (i = 0; i < nsupervised; i++)
+		if (supervised[i].state == SupBackoff && (!due || supervised[i].retry < due))
+			due = supervised[i].retry;
+	if (due) {
+		its.it_value.tv_sec = due / 1000;
+		its.it_value.tv_nsec = due % 1000 * 1000000 + 1;
+	}
+	timerfd_settime(sup_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+/* launch scripts tend to start the bar in the background and exit, so
+ * the bar's window going away is what tells of its crash; the script is
+ * run again unless a bar showed up by itself in the meantime */
+void
+supervisebar(void)
+{
+	Supervised *s;
+	long now = nowms();
+
+	if (barsup < 0 || !running)
+		return;
+	s = &supervised[barsup];
+	if (s->state != SupDone)
+		return;
+	if (now - s->started >= SUPSTABLE)
+		s->restarts = 0;
+	s->retry = now + MIN((long)SUPBACKOFF << MIN(s->restarts, 16), SUPBACKOFFMAX);
+	s->restarts++;
+	s->state = SupBackoff;
+	fprintf(stderr, "dwm: bar window of %s went away, restarting in %ldms\n",
+		s->name, s->retry - now);
+	supervisearm();
+}
+
+/* a clean exit is left alone, a crash is restarted after a delay that
+ * doubles with every crash until it stays up for SUPSTABLE ms */
+void
+supervisereap(pid_t pid, int status)
+{
+	Supervised *s;
+	long now = nowms();
+	unsigned int i;
+
+	for (i = 0; i < nsupervised && supervised[i].pid != pid; i++);
+	if (i == nsupervised)
+		return;
+	s = &supervised[i];
+	s->pid = 0;
+	journaldirty = 1;
+	if (s->state == SupStopped || !running)
+		return;
+	if (status != -1 && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+		s->state = SupDone;
+		return;
+	}
+	if (now - s->started >= SUPSTABLE)
+		s->restarts = 0;
+	s->retry = now + MIN((long)SUPBACKOFF << MIN(s->restarts, 16), SUPBACKOFFMAX);
+	s->restarts++;
+	s->state = SupBackoff;
+	fprintf(stderr, "dwm: %s exited with status %d, restarting in %ldms\n",
+		s->name, status, s->retry - now);
+	supervisearm();
+}
+
+void
+superviserun(Supervised *s)
+{
+	journaldirty = 1;
+	s->started = nowms();
+	if ((s->pid = spawnpid(s->cmd)) > 0) {
+		s->state = SupRunning;
+		return;
+	}
+	s->pid = 0;
+	s->state = SupBackoff;
+	s->retry = s->started + MIN((long)SUPBACKOFF << MIN(s->restarts, 16), SUPBACKOFFMAX);
+	s->restarts++;
+	supervisearm();
+}
 
-		sigemptyset(&sa.sa_mask);
-		sa.sa_flags = 0;
-		sa.sa_handler = SIG_DFL;
-		sigaction(SIGCHLD, &sa, NULL);
+void
+supervisetick(void)
+{
+	unsigned long long n;
+	long now = nowms();
+	unsigned int i;
+	Monitor *m;
 
-		execvp(((char **)arg->v)[0], (char **)arg->v);
-		die("dwm: execvp '%s' failed:", ((char **)arg->v)[0]);
+	if (read(sup_fd, &n, sizeof n) != sizeof n)
+		return;
+	for (m = mons; m && !m->barwin; m = m->next);
+	for (i = 0; i < nsupervised; i++) {
+		if (supervised[i].state != SupBackoff || supervised[i].retry > now)
+			continue;
+		if ((int)i == barsup && usealtbar && m && !supervised[i].pid)
+			supervised[i].state = SupDone;
+		else
+			superviserun(&supervised[i]);
 	}
+	supervisearm();
 }
 
+/* c takes over the terminal p's place in the lists, the grid and the
+ * layout while p is unmapped until c goes away */
 void
-setclienttagprop(Client *c)
+swallow(Client *p, Client *c)
 {
-	long data[] = { (long) c->tags, (long) c->mon->num };
-	XChangeProperty(dpy, c->win, netatom[NetClientInfo], XA_CARDINAL, 32,
-			PropModeReplace, (unsigned char *) data, 2);
+	Client **tc;
+
+	if (c->info->noswallow || c->info->isterminal
+	|| (c->isfloating && !swallowfloating))
+		return;
+	detach(c);
+	detachstack(c);
+	griddel(c);
+	if (c->mon->sel == c)
+		c->mon->sel = NULL;
+	c->mon = p->mon;
+	c->tags = p->tags;
+	c->row = p->row;
+	c->isfloating = p->isfloating;
+	c->x = p->x;
+	c->y = p->y;
+	c->w = p->w;
+	c->h = p->h;
+	setclienttagprop(c);
+	for (tc = &p->mon->clients; *tc != p; tc = &(*tc)->next);
+	*tc = c;
+	c->next = p->next;
+	for (tc = &p->mon->stack; *tc != p; tc = &(*tc)->snext);
+	*tc = c;
+	c->snext = p->snext;
+	if (p->mon->sel == p)
+		p->mon->sel = c;
+	stacklistdirty = 1;
+	c->info->swallowing = p;
+	XUnmapWindow(dpy, p->win);
+	setclientstate(p, IconicState);
+	clientlistremove(p->win);
+}
+
+Client *
+swallowingclient(Window w)
+{
+	Client *c;
+	Monitor *m;
+
+	for (m = mons; m; m = m->next)
+		for (c = m->clients; c; c = c->next)
+			if (c->info->swallowing && c->info->swallowing->win == w)
+				return c;
+	return NULL;
 }
 
+/* exchange the whole workspace of the selected monitor with the one in
+ * direction arg->i: client lists and view state trade places as they are,
+ * only the clients' back pointers and floating and fullscreen geometry
+ * need fixing; what IPC subscribers last heard stays with the monitor */
 void
-spawnbar()
+swapmon(const Arg *arg)
 {
-	if (*altbarcmd)
-		system(altbarcmd);
+	Monitor *m, *o, *t = dirtomon(arg->i);
+	Client *c;
+	int i;
+	char sym[sizeof selmon->ltsymbol];
+
+	if (!mons->next || t == selmon)
+		return;
+	unfocus(selmon->sel, 0);
+	SWAP(Client *, selmon->clients, t->clients);
+	SWAP(Client *, selmon->stack, t->stack);
+	SWAP(Client *, selmon->sel, t->sel);
+	SWAP(unsigned int, selmon->seltags, t->seltags);
+	SWAP(unsigned int, selmon->tagset[0], t->tagset[0]);
+	SWAP(unsigned int, selmon->tagset[1], t->tagset[1]);
+	SWAP(unsigned int, selmon->row[0], t->row[0]);
+	SWAP(unsigned int, selmon->row[1], t->row[1]);
+	SWAP(Column *, selmon->cols, t->cols);
+	SWAP(unsigned int, selmon->sellt, t->sellt);
+	SWAP(const Layout *, selmon->lt[0], t->lt[0]);
+	SWAP(const Layout *, selmon->lt[1], t->lt[1]);
+	SWAP(float, selmon->mfact, t->mfact);
+	SWAP(int, selmon->nmaster, t->nmaster);
+	memcpy(sym, selmon->ltsymbol, sizeof sym);
+	memcpy(selmon->ltsymbol, t->ltsymbol, sizeof sym);
+	memcpy(t->ltsymbol, sym, sizeof sym);
+	for (i = 0; i < 2; i++)
+		for (m = i ? t : selmon, o = i ? selmon : t, c = m->clients; c; c = c->next) {
+			c->mon = m;
+			if (c->isfullscreen) {
+				c->oldx += m->mx - o->mx;
+				c->oldy += m->my - o->my;
+				resizeclient(c, m->mx, m->my, m->mw, m->mh);
+			} else if (c->isfloating) {
+				c->x = MIN(m->mx + c->x - o->mx, m->mx + m->mw - WIDTH(c));
+				c->y = MIN(m->my + c->y - o->my, m->my + m->mh - HEIGHT(c));
+				c->x = MAX(c->x, m->mx);
+				c->y = MAX(c->y, m->my);
+			}
+			setclienttagprop(c);
+		}
+	arrange(selmon);
+	arrange(t);
+	focus(NULL);
+	updatecurrentdesktop();
 }
 
 void
@@ -2479,13 +5379,38 @@ tag(const Arg *arg)
 	Client *c;
 	if (selmon->sel && arg->ui & TAGMASK) {
 		c = selmon->sel;
-		selmon->sel->tags = arg->ui & TAGMASK;
+		griddel(c);
+		c->tags = arg->ui & TAGMASK;
+		c->row = gridrow(selmon, c->tags);
+		gridadd(c);
 		setclienttagprop(c);
 		focus(NULL);
 		arrange(selmon);
 	}
 }
 
+/* move every client of selmon whose WM_CLASS contains args[0] to the
+ * tags in args[1] */
+void
+tagclass(const Arg *args, int argc)
+{
+	unsigned int newtags;
+	int moved = 0;
+	Client *c;
+
+	if (argc < 2 || !args[0].v || !(newtags = args[1].ui & TAGMASK))
+		return;
+	for (c = selmon->clients; c; c = c->next)
+		if (c->tags != newtags && strstr(c->info->class, args[0].v)) {
+			retag(c, selmon, newtags);
+			moved = 1;
+		}
+	if (moved) {
+		focus(NULL);
+		arrange(selmon);
+	}
+}
+
 void
 tagmon(const Arg *arg)
 {
@@ -2494,6 +5419,22 @@ tagmon(const Arg *arg)
 	sendmon(selmon->sel, dirtomon(arg->i));
 }
 
+/* move the selected client to another inner tag of its columns and follow */
+void
+tagrow(unsigned int row)
+{
+	Client *c = selmon->sel;
+
+	if (!c || c->row == row)
+		return;
+	griddel(c);
+	c->row = row;
+	gridadd(c);
+	setclienttagprop(c);
+	viewrow(row);
+	focus(c);
+}
+
 
 void
 tagtonext(const Arg *arg)
@@ -2525,6 +5466,52 @@ tagtoprev(const Arg *arg)
 	view(&(const Arg){.ui = tmp });
 }
 
+void
+tagup(const Arg *arg)
+{
+	if (selmon->sel && selmon->sel->row > 0)
+		tagrow(selmon->sel->row - 1);
+}
+
+void
+tagdown(const Arg *arg)
+{
+	Client *c = selmon->sel;
+	unsigned int row;
+
+	if (!c)
+		return;
+	/* the client itself does not count as in use */
+	griddel(c);
+	row = gridclamp(selmon, c->tags, c->row + 1);
+	gridadd(c);
+	tagrow(row);
+}
+
+/* the terminal c was started from: the closest ancestor process of c
+ * that owns a terminal window */
+Client *
+termforwin(Client *c)
+{
+	Client *t;
+	Monitor *m;
+	pid_t pid;
+	int depth;
+
+	if (!c->info->pid)
+		return NULL;
+	for (pid = c->info->pid, depth = 0; pid > 1 && depth < 32; depth++) {
+		if (!(pid = getparentprocess(pid)))
+			break;
+		for (m = mons; m; m = m->next)
+			for (t = m->clients; t; t = t->next)
+				if (t != c && t->info->isterminal && t->info->pid == pid
+				&& !t->info->swallowing)
+					return t;
+	}
+	return NULL;
+}
+
 void
 tile(Monitor *m)
 {
@@ -2553,6 +5540,73 @@ tile(Monitor *m)
 		}
 }
 
+void
+titlearm(long due)
+{
+	struct itimerspec its = {{0}};
+
+	if (titledue && titledue <= due)
+		return;
+	titledue = due;
+	/* absolute, and never all zero which would disarm it */
+	its.it_value.tv_sec = due / 1000;
+	its.it_value.tv_nsec = due % 1000 * 1000000 + 1;
+	timerfd_settime(title_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+/* a title change only marks the client; only the selected clients' titles
+ * are watched (bar, IPC), and every title when rules look at them, the
+ * rest wait until someone asks through clientname() */
+void
+titledirty(Client *c)
+{
+	c->info->namestale = 1;
+	if (c != c->mon->sel && !ruletitles)
+		return;
+	if (title_fd == -1)
+		titlerefresh(c);
+	else
+		titlearm(c->info->namefetched + titleinterval);
+}
+
+void
+titlerefresh(Client *c)
+{
+	if (c->info->namestale && updatetitle(c) && c == c->mon->sel)
+		drawbar(c->mon);
+	if (c->info->namerules) {
+		c->info->namerules = 0;
+		updaterules(c);
+	}
+}
+
+void
+titletick(void)
+{
+	unsigned long long n;
+	long now, due;
+	Client *c, *next;
+	Monitor *m;
+
+	if (read(title_fd, &n, sizeof n) != sizeof n)
+		return;
+	titledue = 0;
+	now = nowms();
+	for (m = mons; m; m = m->next)
+		for (c = m->clients; c; c = next) {
+			next = c->next;
+			if (c->info->namestale && (c == m->sel || ruletitles)) {
+				due = c->info->namefetched + titleinterval;
+				if (due > now) {
+					titlearm(due);
+					continue;
+				}
+			} else if (!c->info->namerules)
+				continue;
+			titlerefresh(c);
+		}
+}
+
 void
 togglebar(const Arg *arg)
 {
@@ -2574,6 +5628,38 @@ togglefloating(const Arg *arg)
 	arrange(selmon);
 }
 
+void
+togglescratch(const Arg *arg)
+{
+	unsigned int sptag;
+	Client *c = NULL;
+	Monitor *m;
+
+	if (arg->ui >= LENGTH(scratchpads))
+		return;
+	sptag = SPTAG(arg->ui);
+	for (m = mons; m && !c; m = m->next)
+		for (c = m->clients; c && !(c->tags & sptag); c = c->next);
+	if (!c) {
+		/* it was closed, bring it up once it maps again */
+		scratchshow |= sptag;
+		spawn(&((Arg){.v = scratchpads[arg->ui].cmd}));
+		return;
+	}
+	m = c->mon;
+	if (m == selmon && ISVISIBLE(c)) {
+		retag(c, m, sptag);
+		focus(NULL);
+		arrange(m);
+		return;
+	}
+	retag(c, selmon, sptag | selmon->tagset[selmon->seltags]);
+	if (m != selmon)
+		arrange(m);
+	focus(c);
+	arrange(selmon);
+}
+
 void
 toggletag(const Arg *arg)
 {
@@ -2583,7 +5669,9 @@ toggletag(const Arg *arg)
 		return;
 	newtags = selmon->sel->tags ^ (arg->ui & TAGMASK);
 	if (newtags) {
+		griddel(selmon->sel);
 		selmon->sel->tags = newtags;
+		gridadd(selmon->sel);
 		setclienttagprop(selmon->sel);
 		focus(NULL);
 		arrange(selmon);
@@ -2623,8 +5711,13 @@ unmanage(Client *c, int destroyed)
 	Monitor *m = c->mon;
 	XWindowChanges wc;
 
-	detach(c);
-	detachstack(c);
+	if (c->info->swallowing)
+		unswallow(c);
+	else {
+		detach(c);
+		detachstack(c);
+		griddel(c);
+	}
 	if (!destroyed) {
 		wc.border_width = c->oldbw;
 		XGrabServer(dpy); /* avoid race conditions */
@@ -2637,9 +5730,9 @@ unmanage(Client *c, int destroyed)
 		XSetErrorHandler(xerror);
 		XUngrabServer(dpy);
 	}
-	free(c);
+	clientlistremove(c->win);
+	clientfree(c);
 	focus(NULL);
-	updateclientlist();
 	arrange(m);
 	if (m == selmon && m->sel)
 		XWarpPointer(dpy, None, m->sel->win, 0, 0, 0, 0,
@@ -2654,9 +5747,11 @@ unmanagealtbar(Window w)
     if (!m)
         return;
 
+    lostbar = w;
     m->barwin = 0;
     m->by = 0;
     m->bh = 0;
+    clientlistremove(w);
     updatebarpos(m);
     arrange(m);
 }
@@ -2677,6 +5772,31 @@ unmapnotify(XEvent *e)
 		unmanagealtbar(ev->window);
 }
 
+/* gives the terminal c swallowed back c's place */
+void
+unswallow(Client *c)
+{
+	Client *p = c->info->swallowing, **tc;
+
+	c->info->swallowing = NULL;
+	p->mon = c->mon;
+	p->tags = c->tags;
+	p->row = c->row;
+	setclienttagprop(p);
+	for (tc = &c->mon->clients; *tc != c; tc = &(*tc)->next);
+	*tc = p;
+	p->next = c->next;
+	for (tc = &c->mon->stack; *tc != c; tc = &(*tc)->snext);
+	*tc = p;
+	p->snext = c->snext;
+	if (c->mon->sel == c)
+		c->mon->sel = p;
+	stacklistdirty = 1;
+	clientlistadd(p->win);
+	setclientstate(p, NormalState);
+	XMapWindow(dpy, p->win);
+}
+
 void
 updatebars(void)
 {
@@ -2687,7 +5807,7 @@ updatebars(void)
 	XSetWindowAttributes wa = {
 		.override_redirect = True,
 		.background_pixmap = ParentRelative,
-		.event_mask = ButtonPressMask|ExposureMask
+		.event_mask = ButtonPressMask|ExposureMask|PointerMotionMask
 	};
 	XClassHint ch = {"dwm", "dwm"};
 	for (m = mons; m; m = m->next) {
@@ -2715,18 +5835,57 @@ updatebarpos(Monitor *m)
 		m->by = -m->bh;
 }
 
+void
+updateclass(Client *c)
+{
+	XClassHint ch = { NULL, NULL };
+
+	XGetClassHint(dpy, c->win, &ch);
+	c->info->class = intern(ch.res_class ? ch.res_class : broken);
+	c->info->instance = intern(ch.res_name ? ch.res_name : broken);
+	if (ch.res_class)
+		XFree(ch.res_class);
+	if (ch.res_name)
+		XFree(ch.res_name);
+}
+
 void
 updateclientlist(void)
 {
 	Client *c;
 	Monitor *m;
+	Window w;
+	unsigned int i, j, k, n;
 
-	XDeleteProperty(dpy, root, netatom[NetClientList]);
-	for (m = mons; m; m = m->next)
-		for (c = m->clients; c; c = c->next)
-			XChangeProperty(dpy, root, netatom[NetClientList],
-				XA_WINDOW, 32, PropModeAppend,
-				(unsigned char *) &(c->win), 1);
+	if (clientlistdirty) {
+		XChangeProperty(dpy, root, netatom[NetClientList], XA_WINDOW, 32,
+			PropModeReplace, (unsigned char *) clientlist, nclientlist);
+		clientlistdirty = 0;
+	}
+	if (stacklistdirty) {
+		/* the property runs bottom to top, per monitor in the order
+		 * restack() leaves it: hidden clients, the tiled ones beneath
+		 * the bar, then the floating ones with the focused one raised.
+		 * The focus stack is kept top first, so each run is reversed */
+		n = 0;
+		for (m = mons; m; m = m->next)
+			for (k = 0; k < 3; k++) {
+				for (i = n, c = m->stack; c; c = c->snext)
+					if (k == (!ISVISIBLE(c) ? 0
+					: !c->isfloating && m->lt[m->sellt]->arrange ? 1 : 2))
+						stacklist[n++] = c->win;
+				for (j = n - 1; i < j; i++, j--) {
+					w = stacklist[i];
+					stacklist[i] = stacklist[j];
+					stacklist[j] = w;
+				}
+				if (k == 1 && usealtbar && m->barwin)
+					stacklist[n++] = m->barwin;
+			}
+		XChangeProperty(dpy, root, netatom[NetClientListStacking], XA_WINDOW, 32,
+			PropModeReplace, (unsigned char *) stacklist, n);
+		stacklistdirty = 0;
+	}
 }
 
 void updatecurrentdesktop(void){
@@ -2750,11 +5909,52 @@ void updatecurrentdesktop(void){
 /* 	XChangeProperty(dpy, root, netatom[NetCurrentDesktop], XA_CARDINAL, 32, PropModeReplace, (unsigned char *)data, 1); */
 /* } */
 
+/* InputOnly windows below every client stand in for root pointer motion:
+ * one over each monitor, whose Enter events tell when the pointer moved
+ * there over the bare desktop, and strips along its edges that wake
+ * checkedgeswitch() only when they are crossed */
+void
+updateedges(void)
+{
+	XSetWindowAttributes wa = {
+		.override_redirect = True,
+		.event_mask = EnterWindowMask
+	};
+	XRectangle r[LENGTH(mons->edgewin)];
+	Monitor *m;
+	int i, t = EDGETHRESHOLD;
+
+	for (m = mons; m; m = m->next) {
+		r[0] = (XRectangle){ m->mx, m->my, m->mw, m->mh };
+		r[1] = (XRectangle){ m->mx, m->my, t, m->mh };
+		r[2] = (XRectangle){ m->mx + m->mw - t + 1, m->my, t - 1, m->mh };
+		r[3] = (XRectangle){ m->mx, m->my, m->mw, t };
+		r[4] = (XRectangle){ m->mx, m->my + m->mh - t + 1, m->mw, t - 1 };
+		/* the strips go down first so the backdrop ends up beneath them */
+		for (i = LENGTH(r) - 1; i >= 0; i--) {
+			if (!m->edgewin[i]) {
+				m->edgewin[i] = XCreateWindow(dpy, root, r[i].x, r[i].y, r[i].width,
+					r[i].height, 0, 0, InputOnly, CopyFromParent,
+					CWOverrideRedirect|CWEventMask, &wa);
+				XMapWindow(dpy, m->edgewin[i]);
+			} else
+				XMoveResizeWindow(dpy, m->edgewin[i], r[i].x, r[i].y, r[i].width, r[i].height);
+			XLowerWindow(dpy, m->edgewin[i]);
+		}
+	}
+}
+
 int
 updategeom(void)
 {
 	int dirty = 0;
 
+	if ((dirty = rrmonitors()) != -1) {
+		updatemonindex();
+		return dirty;
+	}
+	dirty = 0;
+
 #ifdef XINERAMA
 	if (XineramaIsActive(dpy)) {
 		int i, j, n, nn;
@@ -2792,17 +5992,14 @@ updategeom(void)
 				m->mw = m->ww = unique[i].width;
 				m->mh = m->wh = unique[i].height;
 				updatebarpos(m);
+				m->geomdirty = 1;
 			}
 		/* removed monitors if n > nn */
 		for (i = nn; i < n; i++) {
 			for (m = mons; m && m->next; m = m->next);
 			while ((c = m->clients)) {
-				dirty = 1;
-				m->clients = c->next;
-				detachstack(c);
-				c->mon = mons;
-				attach(c);
-				attachstack(c);
+				dirty = mons->geomdirty = 1;
+				movetomon(c, mons);
 			}
 			if (m == selmon)
 				selmon = mons;
@@ -2819,8 +6016,10 @@ updategeom(void)
 			mons->mw = mons->ww = sw;
 			mons->mh = mons->wh = sh;
 			updatebarpos(mons);
+			mons->geomdirty = 1;
 		}
 	}
+	updatemonindex();
 	if (dirty) {
 		selmon = mons;
 		selmon = wintomon(root);
@@ -2828,6 +6027,53 @@ updategeom(void)
 	return dirty;
 }
 
+/* sorts the monitors by their left edge for pointtomon() */
+void
+updatemonindex(void)
+{
+	Monitor *m;
+	unsigned int i, n;
+
+	for (n = 0, m = mons; m; m = m->next, n++);
+	if (!(monindex = realloc(monindex, MAX(n, 1) * sizeof(Monitor *))))
+		die("realloc:");
+	for (nmonindex = 0, m = mons; m; m = m->next, nmonindex++) {
+		for (i = nmonindex; i > 0 && monindex[i - 1]->mx > m->mx; i--)
+			monindex[i] = monindex[i - 1];
+		monindex[i] = m;
+	}
+	ptrmon = NULL;
+}
+
+/* applies what the last burst of RandR events or root ConfigureNotify
+ * changed; only the monitors that changed are arranged */
+void
+updatemons(void)
+{
+	Monitor *m;
+	Client *c;
+
+	monsdirty = 0;
+	updategeom();
+	for (m = mons; m && !m->geomdirty; m = m->next);
+	if (!m)
+		return;
+	updatebars();
+	updateedges();
+	updaterefresh();
+	for (m = mons; m; m = m->next) {
+		if (!m->geomdirty)
+			continue;
+		m->geomdirty = 0;
+		for (c = m->clients; c; c = c->next)
+			if (c->isfullscreen)
+				resizeclient(c, m->mx, m->my, m->mw, m->mh);
+		XMoveResizeWindow(dpy, m->barwin, m->wx, m->by, m->ww, m->bh);
+		arrange(m);
+	}
+	focus(NULL);
+}
+
 void
 updatenumlockmask(void)
 {
@@ -2844,6 +6090,71 @@ updatenumlockmask(void)
 	XFreeModifiermap(modmap);
 }
 
+void
+updaterefresh(void)
+{
+	Monitor *m;
+
+	for (m = mons; m; m = m->next)
+		m->refresh = 0;
+#ifdef XRANDR
+	int i, j, di;
+	XRRScreenResources *res;
+	XRRCrtcInfo *ci;
+	XRRModeInfo *mi;
+
+	if (XRRQueryExtension(dpy, &di, &di)
+	&& (res = XRRGetScreenResourcesCurrent(dpy, root))) {
+		for (i = 0; i < res->ncrtc; i++) {
+			if (!(ci = XRRGetCrtcInfo(dpy, res, res->crtcs[i])))
+				continue;
+			for (j = 0, mi = NULL; j < res->nmode && !mi; j++)
+				if (res->modes[j].id == ci->mode)
+					mi = &res->modes[j];
+			/* a monitor is driven by the crtc its origin lies on */
+			if (mi && mi->hTotal && mi->vTotal)
+				for (m = mons; m; m = m->next)
+					if (m->mx >= ci->x && m->mx < ci->x + (int)ci->width
+					&& m->my >= ci->y && m->my < ci->y + (int)ci->height)
+						m->refresh = MAX(m->refresh, (int)((double)mi->dotClock
+							/ (mi->hTotal * mi->vTotal) + 0.5));
+			XRRFreeCrtcInfo(ci);
+		}
+		XRRFreeScreenResources(res);
+	}
+#endif /* XRANDR */
+	for (m = mons; m; m = m->next)
+		if (!m->refresh)
+			m->refresh = animrefresh;
+}
+
+/* re-run the rules after WM_CLASS or the title changed; the client only
+ * moves when a different set of rules matches than before */
+void
+updaterules(Client *c)
+{
+	unsigned int newtags = 0, key;
+	int isfloating = 0;
+	Monitor *m = c->mon, *mon = c->mon;
+
+	if ((key = matchrules(c, c->info->class, c->info->instance, &newtags, &isfloating, &mon)) == c->info->rulekey)
+		return;
+	c->info->rulekey = key;
+	if (!key)
+		return;
+	if (!(newtags &= TAGMASK))
+		newtags = c->tags;
+	if (newtags == c->tags && mon == m && (!isfloating || c->isfloating))
+		return;
+	if (isfloating)
+		c->isfloating = 1;
+	retag(c, mon, newtags);
+	focus(NULL);
+	arrange(m);
+	if (mon != m)
+		arrange(mon);
+}
+
 void
 updatesizehints(Client *c)
 {
@@ -2853,39 +6164,7 @@ updatesizehints(Client *c)
 	if (!XGetWMNormalHints(dpy, c->win, &size, &msize))
 		/* size is uninitialized, ensure that size.flags aren't used */
 		size.flags = PSize;
-	if (size.flags & PBaseSize) {
-		c->basew = size.base_width;
-		c->baseh = size.base_height;
-	} else if (size.flags & PMinSize) {
-		c->basew = size.min_width;
-		c->baseh = size.min_height;
-	} else
-		c->basew = c->baseh = 0;
-	if (size.flags & PResizeInc) {
-		c->incw = size.width_inc;
-		c->inch = size.height_inc;
-	} else
-		c->incw = c->inch = 0;
-	if (size.flags & PMaxSize) {
-		c->maxw = size.max_width;
-		c->maxh = size.max_height;
-	} else
-		c->maxw = c->maxh = 0;
-	if (size.flags & PMinSize) {
-		c->minw = size.min_width;
-		c->minh = size.min_height;
-	} else if (size.flags & PBaseSize) {
-		c->minw = size.base_width;
-		c->minh = size.base_height;
-	} else
-		c->minw = c->minh = 0;
-	if (size.flags & PAspect) {
-		c->mina = (float)size.min_aspect.y / size.min_aspect.x;
-		c->maxa = (float)size.max_aspect.x / size.max_aspect.y;
-	} else
-		c->maxa = c->mina = 0.0;
-	c->isfixed = (c->maxw && c->maxh && c->maxw == c->minw && c->maxh == c->minh);
-	c->hintsvalid = 1;
+	setsizehints(c, &size);
 }
 
 void
@@ -2896,33 +6175,39 @@ updatestatus(void)
 	drawbar(selmon);
 }
 
-void
+int
 updatetitle(Client *c)
 {
-	char oldname[sizeof(c->name)];
-	strcpy(oldname, c->name);
+	char name[256];
 
-	if (!gettextprop(c->win, netatom[NetWMName], c->name, sizeof c->name))
-		gettextprop(c->win, XA_WM_NAME, c->name, sizeof c->name);
-	if (c->name[0] == '\0') /* hack to mark broken clients */
-		strcpy(c->name, broken);
+	c->info->namestale = 0;
+	c->info->namefetched = nowms();
+	if (!gettextprop(c->win, netatom[NetWMName], name, sizeof name))
+		gettextprop(c->win, XA_WM_NAME, name, sizeof name);
+	if (name[0] == '\0') /* hack to mark broken clients */
+		strcpy(name, broken);
+	if (!strcmp(name, c->info->name))
+		return 0;
 
 	for (Monitor *m = mons; m; m = m->next) {
-		if (m->sel == c && strcmp(oldname, c->name) != 0)
-			ipc_focused_title_change_event(m->num, c->win, oldname, c->name);
+		if (m->sel == c)
+			ipc_focused_title_change_event(m->num, c->win, c->info->name, name);
 	}
+	free(c->info->name);
+	c->info->name = estrdup(name);
+	if (ruletitles) {
+		/* rules run from the timer, not from whoever asked for the name */
+		c->info->namerules = 1;
+		titlearm(c->info->namefetched);
+	}
+	return 1;
 }
 
 void
 updatewindowtype(Client *c)
 {
-	Atom state = getatomprop(c, netatom[NetWMState]);
-	Atom wtype = getatomprop(c, netatom[NetWMWindowType]);
-
-	if (state == netatom[NetWMFullscreen])
-		setfullscreen(c, 1);
-	if (wtype == netatom[NetWMWindowTypeDialog])
-		c->isfloating = 1;
+	setwindowtype(c, getatomprop(c, netatom[NetWMState]),
+		getatomprop(c, netatom[NetWMWindowType]));
 }
 
 void
@@ -2931,17 +6216,10 @@ updatewmhints(Client *c)
 	XWMHints *wmh;
 
 	if ((wmh = XGetWMHints(dpy, c->win))) {
-		if (c == selmon->sel && wmh->flags & XUrgencyHint) {
-			wmh->flags &= ~XUrgencyHint;
-			XSetWMHints(dpy, c->win, wmh);
-		} else
-			c->isurgent = (wmh->flags & XUrgencyHint) ? 1 : 0;
-		if (wmh->flags & InputHint)
-			c->neverfocus = !wmh->input;
-		else
-			c->neverfocus = 0;
+		setwmhints(c, wmh);
 		XFree(wmh);
-	}
+	} else
+		c->info->haswmh = 0;
 }
 
 void
@@ -2993,41 +6271,61 @@ window_unmap(Display *dpy, Window win, Window root, int iconify)
 void
 view(const Arg *arg)
 {
+    unsigned int i, row;
+
     if ((arg->ui & TAGMASK) == selmon->tagset[selmon->seltags])
         return;
+    /* before the toggle, gridrow() still compares against what is shown */
+    row = gridrow(selmon, arg->ui & TAGMASK);
     selmon->seltags ^= 1; /* toggle sel tagset */
-    if (arg->ui & TAGMASK)
+    if (arg->ui & TAGMASK) {
         selmon->tagset[selmon->seltags] = arg->ui & TAGMASK;
+        selmon->row[selmon->seltags] = row;
+    }
+    for (i = 0; i < LENGTH(tags); i++)
+        if (selmon->tagset[selmon->seltags] & 1 << i)
+            selmon->cols[i].row = selmon->row[selmon->seltags];
     focus(NULL);
+    animview = running && animframes > 0 && anim_fd != -1;
     arrange(selmon);
     updatecurrentdesktop();
 }
 
+/* show another inner tag of the columns in view */
 void
-viewvertical(const Arg *arg)
+viewrow(unsigned int row)
 {
-    isVerticalMove = 1;  // Set the global flag for vertical movement
-    if ((arg->ui & TAGMASK) == selmon->tagset[selmon->seltags])
+    unsigned int i;
+
+    if (row == selmon->row[selmon->seltags])
         return;
     selmon->seltags ^= 1; /* toggle sel tagset */
-    if (arg->ui & TAGMASK)
-        selmon->tagset[selmon->seltags] = arg->ui & TAGMASK;
+    selmon->tagset[selmon->seltags] = selmon->tagset[selmon->seltags ^ 1];
+    selmon->row[selmon->seltags] = row;
+    for (i = 0; i < LENGTH(tags); i++)
+        if (selmon->tagset[selmon->seltags] & 1 << i)
+            selmon->cols[i].row = row;
     focus(NULL);
+    animview = running && animframes > 0 && anim_fd != -1;
     arrange(selmon);
     updatecurrentdesktop();
-    isVerticalMove = 0;  // Reset the flag after arrangement
 }
 
 void
 viewup(const Arg *arg)
 {
-    viewvertical(&(const Arg){.ui = prevtag()});
+    if (selmon->row[selmon->seltags] > 0)
+        viewrow(selmon->row[selmon->seltags] - 1);
 }
 
 void
 viewdown(const Arg *arg)
 {
-    viewvertical(&(const Arg){.ui = nexttag()});
+    unsigned int row = selmon->row[selmon->seltags];
+
+    /* empty rows may be passed on the way to used ones further down */
+    if (gridclamp(selmon, selmon->tagset[selmon->seltags], row + 1) > row)
+        viewrow(row + 1);
 }
 
 void
@@ -3042,6 +6340,14 @@ viewprev(const Arg *arg)
     view(&(const Arg){.ui = prevtag()});
 }
  
+int
+windowcmp(const void *a, const void *b)
+{
+	Window x = *(const Window *)a, y = *(const Window *)b;
+
+	return x < y ? -1 : x > y;
+}
+
 Client *
 wintoclient(Window w)
 {
@@ -3072,28 +6378,6 @@ wintomon(Window w)
 	return selmon;
 }
 
-int
-wmclasscontains(Window win, const char *class, const char *name)
-{
-	XClassHint ch = { NULL, NULL };
-	int res = 1;
-
-	if (XGetClassHint(dpy, win, &ch)) {
-		if (ch.res_name && strstr(ch.res_name, name) == NULL)
-			res = 0;
-		if (ch.res_class && strstr(ch.res_class, class) == NULL)
-			res = 0;
-	} else
-		res = 0;
-
-	if (ch.res_class)
-		XFree(ch.res_class);
-	if (ch.res_name)
-		XFree(ch.res_name);
-
-	return res;
-}
-
 /* There's no way to check accesses to destroyed windows, thus those cases are
  * ignored (especially on UnmapNotify's). Other types of errors call Xlibs
  * default error handler, which may call exit. */
@@ -3145,6 +6429,8 @@ zoom(const Arg *arg)
 int
 main(int argc, char *argv[])
 {
+	int recovering;
+
 	if (argc == 2 && !strcmp("-v", argv[1]))
 		die("dwm-"VERSION);
 	else if (argc != 1)
@@ -3154,13 +6440,21 @@ main(int argc, char *argv[])
 	if (!(dpy = XOpenDisplay(NULL)))
 		die("dwm: cannot open display");
 	checkotherwm();
+	ipc_handoff_claim();
+	snapshotload();
+	journalload();
+	recovering = snapbuf != NULL;
 	autostart_exec();
 	setup();
 #ifdef __OpenBSD__
-	if (pledge("stdio rpath proc exec", NULL) == -1)
+	if (pledge("stdio rpath wpath cpath proc exec", NULL) == -1)
 		die("pledge");
 #endif /* __OpenBSD__ */
 	scan();
+	spawnscratch();
+	poolfill();
+	if (loadsession && !recovering)
+		sessionload(NULL);
 	run();
 	cleanup();
 	XCloseDisplay(dpy);
@@ -3222,7 +6516,7 @@ void aspectresize(const Arg *arg) {
     nh = c->h + h;
     
     /* Check if new size would be smaller than minimum allowed */
-    if (nw < c->minw || nh < c->minh)
+    if (nw < c->info->minw || nh < c->info->minh)
         return;
         
     /* Calculate position changes to maintain center point */
@@ -3279,14 +6573,18 @@ int cursorOverClient(int x, int y) {
 
 #include <time.h>
 
-void checkedgeswitch(void) {
-    int x, y;
+/* x and y come with the motion event, away from the edges nothing is done */
+void checkedgeswitch(int x, int y) {
     static int wasAtEdge = 0;
     static time_t last_switch_time = 0;
     time_t current_time;
     int isDragging = 0;
 
-    XQueryPointer(dpy, root, &(Window){0}, &(Window){0}, &x, &y, &(int){0}, &(int){0}, &(unsigned int){0});
+    if (x >= EDGETHRESHOLD && x <= selmon->mx + selmon->mw - EDGETHRESHOLD
+    && y >= EDGETHRESHOLD && y <= selmon->my + selmon->mh - EDGETHRESHOLD) {
+        wasAtEdge = 0;
+        return;
+    }
 
     if (cursorOverClient(x, y)) {
         return; // Exit the function if the cursor is over any client window
@@ -3319,9 +6617,9 @@ void checkedgeswitch(void) {
         }
     } else if (y < EDGETHRESHOLD) {
         if (!wasAtEdge || (current_time - last_switch_time) > 2) {
-            if (selmon->tagset[selmon->seltags] > 1) {
+            if (selmon->row[selmon->seltags] > 0) {
                 if ((!isDragging && MOUSEEDGESWITCH) || (isDragging && DRAGGEDGESWITCH)) {
-                    viewvertical(&((Arg) {.ui = prevtag()}));
+                    viewup(NULL);
                     wasAtEdge = 1;
                     last_switch_time = current_time;
                 }
@@ -3329,9 +6627,10 @@ void checkedgeswitch(void) {
         }
     } else if (y > (selmon->my + selmon->mh - EDGETHRESHOLD)) {
         if (!wasAtEdge || (current_time - last_switch_time) > 2) {
-            if (selmon->tagset[selmon->seltags] < (1 << (LENGTH(tags) - 1))) {
+            if (gridclamp(selmon, selmon->tagset[selmon->seltags], selmon->row[selmon->seltags] + 1)
+            > selmon->row[selmon->seltags]) {
                 if ((!isDragging && MOUSEEDGESWITCH) || (isDragging && DRAGGEDGESWITCH)) {
-                    viewvertical(&((Arg) {.ui = nexttag()}));
+                    viewdown(NULL);
                     wasAtEdge = 1;
                     last_switch_time = current_time;
                 }
@@ -3,6 +3,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -19,8 +20,11 @@
 static struct sockaddr_un sockaddr;
 static struct epoll_event sock_epoll_event;
 static IPCClientList ipc_clients = NULL;
-static int epoll_fd = -1;
+static int epoll_fd;  // defined -1 by dwm.c, which includes this file
 static int sock_fd = -1;
+// Inherited through DWM_IPC_FDS, until ipc_init adopts or closes them
+static int *handoff_fds;
+static int handoff_nfds;
 static IPCCommand *ipc_commands;
 static unsigned int ipc_commands_len;
 // Max size is 1 MB
@@ -82,6 +86,96 @@ ipc_create_socket(const char *filename)
   return sock_fd;
 }
 
+/**
+ * Copy size bytes at *off in a handoff buffer to dst and advance *off.
+ *
+ * Returns 0 on success
+ * Returns -1 if the buffer is too short
+ */
+static int
+ipc_handoff_read(const char *buf, size_t len, size_t *off, void *dst,
+                 size_t size)
+{
+  if (size > len - *off) return -1;
+  memcpy(dst, buf + *off, size);
+  *off += size;
+  return 0;
+}
+
+/**
+ * Whether fd was listed in DWM_IPC_FDS when ipc_handoff_claim() ran
+ */
+static int
+ipc_handoff_claimed(int fd)
+{
+  for (int i = 0; i < handoff_nfds; i++)
+    if (handoff_fds[i] == fd) return 1;
+  return 0;
+}
+
+/**
+ * Take over the socket and clients a previous image passed through
+ * ipc_handoff(). Only fds claimed from DWM_IPC_FDS are taken. This
+ * initializes the static variable sockaddr.
+ *
+ * Returns the socket file descriptor, or -1 if it has to be created anew
+ */
+static int
+ipc_adopt(const char *buf, size_t len)
+{
+  socklen_t addr_size = sizeof(struct sockaddr_un);
+  size_t off = 0;
+  int32_t fd, subscriptions;
+  uint32_t n, buffer_size;
+
+  if (ipc_handoff_read(buf, len, &off, &fd, sizeof fd) < 0 ||
+      ipc_handoff_read(buf, len, &off, &n, sizeof n) < 0)
+    return -1;
+
+  memset(&sockaddr, 0, addr_size);
+  if (fd >= 0 && ipc_handoff_claimed(fd) &&
+      getsockname(fd, (struct sockaddr *)&sockaddr, &addr_size) == 0
+      && sockaddr.sun_family == AF_LOCAL) {
+    sock_fd = fd;
+  }
+
+  for (; n > 0; n--) {
+    if (ipc_handoff_read(buf, len, &off, &fd, sizeof fd) < 0 ||
+        ipc_handoff_read(buf, len, &off, &subscriptions,
+                         sizeof subscriptions) < 0 ||
+        ipc_handoff_read(buf, len, &off, &buffer_size, sizeof buffer_size) < 0 ||
+        buffer_size > len - off)
+      break;
+
+    if (!ipc_handoff_claimed(fd) || ipc_get_client(fd)) {
+      off += buffer_size;
+      continue;
+    }
+
+    IPCClient *nc = ipc_client_new(fd);
+    if (nc == NULL) break;
+
+    nc->subscriptions = subscriptions;
+    if (buffer_size > 0) {
+      nc->buffer = (char *)malloc(buffer_size);
+      memcpy(nc->buffer, buf + off, buffer_size);
+      nc->buffer_size = buffer_size;
+      off += buffer_size;
+    }
+
+    nc->event.data.fd = fd;
+    nc->event.events = EPOLLIN | EPOLLHUP;
+    if (nc->buffer_size > 0) nc->event.events |= EPOLLOUT;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &nc->event);
+
+    ipc_list_add_client(&ipc_clients, nc);
+
+    DEBUG("Adopted client at fd %d\n", fd);
+  }
+
+  return sock_fd;
+}
+
 /**
  * Internal function used to receive IPC messages from a given file descriptor.
  *
@@ -473,6 +567,8 @@ ipc_event_stoi(const char *subscription, IPCEvent *event)
     *event = IPC_EVENT_FOCUSED_TITLE_CHANGE;
   else if (strcmp(subscription, "focused_state_change_event") == 0)
     *event = IPC_EVENT_FOCUSED_STATE_CHANGE;
+  else if (strcmp(subscription, "restart_event") == 0)
+    *event = IPC_EVENT_RESTART;
   else
     return -1;
   return 0;
@@ -684,6 +780,37 @@ ipc_get_layouts(IPCClient *c, const Layout layouts[], const int layouts_len)
   ipc_reply_prepare_send_message(gen, c, IPC_TYPE_GET_LAYOUTS);
 }
 
+/**
+ * Called when an IPC_TYPE_GET_LAUNCHES message is received from a client. It
+ * prepares a reply with a JSON array of launch latency percentiles per command
+ */
+static void
+ipc_get_launches(IPCClient *c, const Launch *launches, const int launches_len)
+{
+  yajl_gen gen;
+  ipc_reply_init_message(&gen);
+
+  dump_launches(gen, launches, launches_len);
+
+  ipc_reply_prepare_send_message(gen, c, IPC_TYPE_GET_LAUNCHES);
+}
+
+/**
+ * Called when an IPC_TYPE_GET_SUPERVISED message is received from a client. It
+ * prepares a reply with a JSON array of the supervised processes
+ */
+static void
+ipc_get_supervised(IPCClient *c, const Supervised *supervised,
+                   const int supervised_len)
+{
+  yajl_gen gen;
+  ipc_reply_init_message(&gen);
+
+  dump_supervised(gen, supervised, supervised_len);
+
+  ipc_reply_prepare_send_message(gen, c, IPC_TYPE_GET_SUPERVISED);
+}
+
 /**
  * Called when an IPC_TYPE_GET_DWM_CLIENT message is received from a client. It
  * prepares a JSON reply with the properties of the client with the specified
@@ -757,19 +884,32 @@ ipc_subscribe(IPCClient *c, const char *msg)
 
 int
 ipc_init(const char *socket_path, const int p_epoll_fd, IPCCommand commands[],
-         const int commands_len)
+         const int commands_len, const char *handoff, const size_t handoff_len)
 {
+  int socket_fd = -1;
+
   // Initialize struct to 0
   memset(&sock_epoll_event, 0, sizeof(sock_epoll_event));
 
-  int socket_fd = ipc_create_socket(socket_path);
-  if (socket_fd < 0) return -1;
-
   ipc_commands = commands;
   ipc_commands_len = commands_len;
 
   epoll_fd = p_epoll_fd;
 
+  // Keep the socket file and connections of the image we replaced
+  if (handoff) socket_fd = ipc_adopt(handoff, handoff_len);
+
+  // Whatever was inherited but not adopted has no use anymore
+  for (int i = 0; i < handoff_nfds; i++)
+    if (handoff_fds[i] != sock_fd && !ipc_get_client(handoff_fds[i]))
+      close(handoff_fds[i]);
+  free(handoff_fds);
+  handoff_fds = NULL;
+  handoff_nfds = 0;
+
+  if (socket_fd < 0) socket_fd = ipc_create_socket(socket_path);
+  if (socket_fd < 0) return -1;
+
   // Wake up to incoming connection requests
   sock_epoll_event.data.fd = socket_fd;
   sock_epoll_event.events = EPOLLIN;
@@ -781,6 +921,72 @@ ipc_init(const char *socket_path, const int p_epoll_fd, IPCCommand commands[],
   return socket_fd;
 }
 
+void
+ipc_handoff(FILE *f)
+{
+  int32_t fd = sock_fd;
+  uint32_t n = 0;
+  char *fds, *p;
+
+  for (IPCClient *c = ipc_clients; c; c = c->next) n++;
+
+  // Room for every fd as a decimal int and a separator
+  p = fds = ecalloc(n + 1, 12);
+  if (sock_fd >= 0) p += sprintf(p, "%d,", sock_fd);
+
+  fwrite(&fd, sizeof fd, 1, f);
+  fwrite(&n, sizeof n, 1, f);
+  if (sock_fd >= 0) fcntl(sock_fd, F_SETFD, 0);
+
+  for (IPCClient *c = ipc_clients; c; c = c->next) {
+    int32_t subscriptions = c->subscriptions;
+
+    fd = c->fd;
+    fwrite(&fd, sizeof fd, 1, f);
+    fwrite(&subscriptions, sizeof subscriptions, 1, f);
+    fwrite(&c->buffer_size, sizeof c->buffer_size, 1, f);
+    if (c->buffer_size > 0) fwrite(c->buffer, c->buffer_size, 1, f);
+    fcntl(c->fd, F_SETFD, 0);
+    p += sprintf(p, "%d,", c->fd);
+  }
+
+  // The snapshot may be rejected, so the fds are also listed on their own
+  setenv("DWM_IPC_FDS", fds, 1);
+  free(fds);
+}
+
+void
+ipc_handoff_abort()
+{
+  if (sock_fd >= 0) fcntl(sock_fd, F_SETFD, FD_CLOEXEC);
+  for (IPCClient *c = ipc_clients; c; c = c->next)
+    fcntl(c->fd, F_SETFD, FD_CLOEXEC);
+  unsetenv("DWM_IPC_FDS");
+}
+
+void
+ipc_handoff_claim()
+{
+  const char *s = getenv("DWM_IPC_FDS");
+  char *end;
+  long fd;
+
+  if (!s) return;
+
+  for (const char *p = s; *p; p++)
+    if (*p == ',') handoff_nfds++;
+  handoff_fds = ecalloc(handoff_nfds + 1, sizeof(int));
+  handoff_nfds = 0;
+
+  // Keep them from anything spawned before ipc_init decides on them
+  while ((fd = strtol(s, &end, 10)) >= 0 && end != s && *end == ',') {
+    if (fd <= INT_MAX && fcntl(fd, F_SETFD, FD_CLOEXEC) == 0)
+      handoff_fds[handoff_nfds++] = fd;
+    s = end + 1;
+  }
+  unsetenv("DWM_IPC_FDS");
+}
+
 void
 ipc_cleanup()
 {
@@ -1084,6 +1290,15 @@ ipc_focused_state_change_event(const int mon_num, const Window client_id,
   ipc_event_prepare_send_message(gen, IPC_EVENT_FOCUSED_STATE_CHANGE);
 }
 
+void
+ipc_restart_event(const unsigned int restored)
+{
+  yajl_gen gen;
+  ipc_event_init_message(&gen);
+  dump_restart_event(gen, restored);
+  ipc_event_prepare_send_message(gen, IPC_EVENT_RESTART);
+}
+
 void
 ipc_send_events(Monitor *mons, Monitor **lastselmon, Monitor *selmon)
 {
@@ -1091,9 +1306,9 @@ ipc_send_events(Monitor *mons, Monitor **lastselmon, Monitor *selmon)
     unsigned int urg = 0, occ = 0, tagset = 0;
 
     for (Client *c = m->clients; c; c = c->next) {
-      occ |= c->tags;
+      occ |= c->tags & TAGMASK;
 
-      if (c->isurgent) urg |= c->tags;
+      if (c->isurgent) urg |= c->tags & TAGMASK;
     }
     tagset = m->tagset[m->seltags];
 
@@ -1143,7 +1358,10 @@ int
 ipc_handle_client_epoll_event(struct epoll_event *ev, Monitor *mons,
                               Monitor **lastselmon, Monitor *selmon,
                               const char *tags[], const int tags_len,
-                              const Layout *layouts, const int layouts_len)
+                              const Layout *layouts, const int layouts_len,
+                              const Launch *launches, const int launches_len,
+                              const Supervised *supervised,
+                              const int supervised_len)
 {
   int fd = ev->data.fd;
   IPCClient *c = ipc_get_client(fd);
@@ -1168,6 +1386,10 @@ ipc_handle_client_epoll_event(struct epoll_event *ev, Monitor *mons,
       ipc_get_tags(c, tags, tags_len);
     else if (msg_type == IPC_TYPE_GET_LAYOUTS)
       ipc_get_layouts(c, layouts, layouts_len);
+    else if (msg_type == IPC_TYPE_GET_LAUNCHES)
+      ipc_get_launches(c, launches, launches_len);
+    else if (msg_type == IPC_TYPE_GET_SUPERVISED)
+      ipc_get_supervised(c, supervised, supervised_len);
     else if (msg_type == IPC_TYPE_RUN_COMMAND) {
       if (ipc_run_command(c, msg) < 0) return -1;
       ipc_send_events(mons, lastselmon, selmon);
@@ -14,6 +14,8 @@
 
 #define IPCCOMMAND(FUNC, ARGC, TYPES)                                          \
   { #FUNC, {FUNC }, ARGC, (ArgType[ARGC])TYPES }
+#define IPCCOMMANDARGS(FUNC, ARGC, ...)                                        \
+  { #FUNC, {.array_param = FUNC }, ARGC, (ArgType[ARGC])__VA_ARGS__ }
 // clang-format on
 
 typedef enum IPCMessageType {
@@ -23,7 +25,9 @@ typedef enum IPCMessageType {
   IPC_TYPE_GET_LAYOUTS = 3,
   IPC_TYPE_GET_DWM_CLIENT = 4,
   IPC_TYPE_SUBSCRIBE = 5,
-  IPC_TYPE_EVENT = 6
+  IPC_TYPE_EVENT = 6,
+  IPC_TYPE_GET_LAUNCHES = 7,
+  IPC_TYPE_GET_SUPERVISED = 8
 } IPCMessageType;
 
 typedef enum IPCEvent {
@@ -32,7 +36,8 @@ typedef enum IPCEvent {
   IPC_EVENT_LAYOUT_CHANGE = 1 << 2,
   IPC_EVENT_MONITOR_FOCUS_CHANGE = 1 << 3,
   IPC_EVENT_FOCUSED_TITLE_CHANGE = 1 << 4,
-  IPC_EVENT_FOCUSED_STATE_CHANGE = 1 << 5
+  IPC_EVENT_FOCUSED_STATE_CHANGE = 1 << 5,
+  IPC_EVENT_RESTART = 1 << 6
 } IPCEvent;
 
 typedef enum IPCSubscriptionAction {
@@ -87,12 +92,38 @@ typedef struct IPCParsedCommand {
  * @param epoll_fd File descriptor for epoll
  * @param commands Address of IPCCommands array defined in config.h
  * @param commands_len Length of commands[] array
+ * @param handoff What ipc_handoff() wrote before a restart, or NULL. The
+ *   socket and clients in it are adopted instead of binding a new socket.
+ * @param handoff_len Length of handoff in bytes
  *
  * @return int The file descriptor of the socket if it was successfully created,
  *   -1 otherwise
  */
 int ipc_init(const char *socket_path, const int p_epoll_fd,
-             IPCCommand commands[], const int commands_len);
+             IPCCommand commands[], const int commands_len,
+             const char *handoff, const size_t handoff_len);
+
+/**
+ * Write the socket and every connected client, with its subscriptions and
+ * unsent output, to f and let their file descriptors survive exec. The fds
+ * are also listed in DWM_IPC_FDS for ipc_handoff_claim()
+ *
+ * @param f Stream the next image reads back through ipc_init
+ */
+void ipc_handoff(FILE *f);
+
+/**
+ * Undo ipc_handoff() after exec failed: the socket and clients are closed on
+ * exec again and DWM_IPC_FDS is unset
+ */
+void ipc_handoff_abort();
+
+/**
+ * Take the file descriptors listed in DWM_IPC_FDS by the previous image and
+ * mark them close-on-exec. Call before spawning anything; ipc_init adopts
+ * those named in the handoff and closes the rest.
+ */
+void ipc_handoff_claim();
 
 /**
  * Uninitialize the socket and module. Free allocated memory and restore static
@@ -283,6 +314,13 @@ void ipc_focused_state_change_event(const int mon_num, const Window client_id,
  */
 void ipc_send_events(Monitor *mons, Monitor **lastselmon, Monitor *selmon);
 
+/**
+ * Tell subscribers that dwm restarted and which of its clients came back
+ *
+ * @param restored Number of clients rebuilt from the restart snapshot
+ */
+void ipc_restart_event(const unsigned int restored);
+
 /**
  * Handle an epoll event caused by a registered IPC client. Read, process, and
  * handle any received messages from clients. Write pending buffer to client if
@@ -297,6 +335,10 @@ void ipc_send_events(Monitor *mons, Monitor **lastselmon, Monitor *selmon);
  * @param tags_len Length of tags array
  * @param layouts Array of available layouts
  * @param layouts_len Length of layouts array
+ * @param launches Array of per command launch latencies
+ * @param launches_len Length of launches array
+ * @param supervised Array of supervised processes
+ * @param supervised_len Length of supervised array
  *
  * @return 0 if event was successfully handled, -1 on any error receiving
  * or handling incoming messages or unhandled epoll event.
@@ -304,7 +346,11 @@ void ipc_send_events(Monitor *mons, Monitor **lastselmon, Monitor *selmon);
 int ipc_handle_client_epoll_event(struct epoll_event *ev, Monitor *mons,
                                   Monitor **lastselmon, Monitor *selmon,
                                   const char *tags[], const int tags_len,
-                                  const Layout *layouts, const int layouts_len);
+                                  const Layout *layouts, const int layouts_len,
+                                  const Launch *launches,
+                                  const int launches_len,
+                                  const Supervised *supervised,
+                                  const int supervised_len);
 
 /**
  * Handle an epoll event caused by the IPC socket. This function only handles an
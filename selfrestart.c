@@ -57,9 +57,25 @@ char *get_dwm_path(){
 void self_restart(const Arg *arg) {
     char *const argv[] = {get_dwm_path(), NULL};
 
+    char fdstr[16];
+    int fd;
+
     if(argv[0] == NULL){
         return;
     }
 
+    /* the new image picks its clients up from here instead of rescanning */
+    if((fd = snapshotwrite()) != -1){
+        snprintf(fdstr, sizeof fdstr, "%d", fd);
+        setenv("DWM_SNAPSHOT", fdstr, 1);
+    }
+
     execv(argv[0], argv);
+
+    ipc_handoff_abort();
+    if(fd != -1){
+        unsetenv("DWM_SNAPSHOT");
+        close(fd);
+    }
+    free(argv[0]);
 }
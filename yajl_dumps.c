@@ -33,8 +33,9 @@ dump_client(yajl_gen gen, Client *c)
 {
   // clang-format off
   YMAP(
-    YSTR("name"); YSTR(c->name);
+    YSTR("name"); YSTR(clientname(c));
     YSTR("tags"); YINT(c->tags);
+    YSTR("row"); YINT(c->row);
     YSTR("window_id"); YINT(c->win);
     YSTR("monitor_number"); YINT(c->mon->num);
 
@@ -55,24 +56,24 @@ dump_client(yajl_gen gen, Client *c)
 
     YSTR("size_hints"); YMAP(
       YSTR("base"); YMAP(
-        YSTR("width"); YINT(c->basew);
-        YSTR("height"); YINT(c->baseh);
+        YSTR("width"); YINT(c->info->basew);
+        YSTR("height"); YINT(c->info->baseh);
       )
       YSTR("step"); YMAP(
-        YSTR("width"); YINT(c->incw);
-        YSTR("height"); YINT(c->inch);
+        YSTR("width"); YINT(c->info->incw);
+        YSTR("height"); YINT(c->info->inch);
       )
       YSTR("max"); YMAP(
-        YSTR("width"); YINT(c->maxw);
-        YSTR("height"); YINT(c->maxh);
+        YSTR("width"); YINT(c->info->maxw);
+        YSTR("height"); YINT(c->info->maxh);
       )
       YSTR("min"); YMAP(
-        YSTR("width"); YINT(c->minw);
-        YSTR("height"); YINT(c->minh);
+        YSTR("width"); YINT(c->info->minw);
+        YSTR("height"); YINT(c->info->minh);
       )
       YSTR("aspect_ratio"); YMAP(
-        YSTR("min"); YDOUBLE(c->mina);
-        YSTR("max"); YDOUBLE(c->maxa);
+        YSTR("min"); YDOUBLE(c->info->mina);
+        YSTR("max"); YDOUBLE(c->info->maxa);
       )
     )
 
@@ -124,6 +125,11 @@ dump_monitor(yajl_gen gen, Monitor *mon, int is_selected)
       YSTR("old"); YINT(mon->tagset[mon->seltags ^ 1]);
     )
 
+    YSTR("row"); YMAP(
+      YSTR("current");  YINT(mon->row[mon->seltags]);
+      YSTR("old"); YINT(mon->row[mon->seltags ^ 1]);
+    )
+
     YSTR("tag_state"); dump_tag_state(gen, mon->tagstate);
 
     YSTR("clients"); YMAP(
@@ -197,6 +203,77 @@ dump_layouts(yajl_gen gen, const Layout layouts[], const int layouts_len)
   return 0;
 }
 
+static double
+percentile(const float *samples, const int n, const int pct)
+{
+  float v[LAUNCHSAMPLES], t;
+  int i, j;
+
+  for (i = 0; i < n; i++)
+    for (v[j = i] = samples[i]; j > 0 && v[j - 1] > v[j]; j--) {
+      t = v[j];
+      v[j] = v[j - 1];
+      v[j - 1] = t;
+    }
+  return v[(n - 1) * pct / 100];
+}
+
+int
+dump_launches(yajl_gen gen, const Launch launches[], const int launches_len)
+{
+  // clang-format off
+  YARR(
+    for (int i = 0; i < launches_len; i++) {
+      const Launch *l = &launches[i];
+      int n = l->n < LAUNCHSAMPLES ? l->n : LAUNCHSAMPLES;
+      YMAP(
+        YSTR("command"); YSTR(l->cmd);
+        YSTR("launches"); YINT(l->n);
+        YSTR("spawn_to_map"); YMAP(
+          YSTR("p50"); YDOUBLE(percentile(l->map, n, 50));
+          YSTR("p90"); YDOUBLE(percentile(l->map, n, 90));
+          YSTR("p99"); YDOUBLE(percentile(l->map, n, 99));
+        )
+        YSTR("spawn_to_shown"); YMAP(
+          YSTR("p50"); YDOUBLE(percentile(l->shown, n, 50));
+          YSTR("p90"); YDOUBLE(percentile(l->shown, n, 90));
+          YSTR("p99"); YDOUBLE(percentile(l->shown, n, 99));
+        )
+      )
+    }
+  )
+  // clang-format on
+
+  return 0;
+}
+
+int
+dump_supervised(yajl_gen gen, const Supervised supervised[],
+                const int supervised_len)
+{
+  static const char *states[] = {
+    [SupRunning] = "running",
+    [SupBackoff] = "backoff",
+    [SupDone] = "exited",
+    [SupStopped] = "stopped",
+  };
+
+  // clang-format off
+  YARR(
+    for (int i = 0; i < supervised_len; i++) {
+      YMAP(
+        YSTR("name"); YSTR(supervised[i].name);
+        YSTR("pid"); YINT(supervised[i].pid);
+        YSTR("state"); YSTR(states[supervised[i].state]);
+        YSTR("restarts"); YINT(supervised[i].restarts);
+      )
+    }
+  )
+  // clang-format on
+
+  return 0;
+}
+
 int
 dump_tag_state(yajl_gen gen, TagState state)
 {
@@ -337,6 +414,20 @@ dump_focused_state_change_event(yajl_gen gen, const int mon_num,
   return 0;
 }
 
+int
+dump_restart_event(yajl_gen gen, const unsigned int restored)
+{
+  // clang-format off
+  YMAP(
+    YSTR("restart_event"); YMAP(
+      YSTR("restored_clients"); YINT(restored);
+    )
+  )
+  // clang-format on
+
+  return 0;
+}
+
 int
 dump_error_message(yajl_gen gen, const char *reason)
 {
@@ -34,6 +34,11 @@ int dump_monitors(yajl_gen gen, Monitor *mons, Monitor *selmon);
 
 int dump_layouts(yajl_gen gen, const Layout layouts[], const int layouts_len);
 
+int dump_launches(yajl_gen gen, const Launch launches[], const int launches_len);
+
+int dump_supervised(yajl_gen gen, const Supervised supervised[],
+                    const int supervised_len);
+
 int dump_tag_state(yajl_gen gen, TagState state);
 
 int dump_tag_event(yajl_gen gen, int mon_num, TagState old_state,
@@ -60,6 +65,8 @@ int dump_focused_state_change_event(yajl_gen gen, const int mon_num,
                                     const ClientState *old_state,
                                     const ClientState *new_state);
 
+int dump_restart_event(yajl_gen gen, const unsigned int restored);
+
 int dump_error_message(yajl_gen gen, const char *reason);
 
 #endif  // YAJL_DUMPS_H_